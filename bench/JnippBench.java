@@ -0,0 +1,23 @@
+// Fixture for jvm_bench.cpp: one field and one getter per JNI type.
+public class JnippBench {
+    public boolean z = true;
+    public byte b = 1;
+    public char c = 'c';
+    public short s = 2;
+    public int i = 3;
+    public long j = 4L;
+    public float f = 5.0f;
+    public double d = 6.0;
+    public String text = "jnipp benchmark string";
+
+    public void getV() {}
+    public boolean getZ() { return z; }
+    public byte getB() { return b; }
+    public char getC() { return c; }
+    public short getS() { return s; }
+    public int getI() { return i; }
+    public long getJ() { return j; }
+    public float getF() { return f; }
+    public double getD() { return d; }
+    public Object getL() { return this; }
+}
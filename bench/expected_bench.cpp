@@ -0,0 +1,70 @@
+//=============================================================================
+//! \file    jnipp/bench/expected_bench.cpp
+//! \brief   ornew::expected vs. exceptions vs. raw return codes
+//!
+//! Build: c++ -O2 -std=c++14 -I src -I $JAVA_HOME/include
+//!          -I $JAVA_HOME/include/linux bench/expected_bench.cpp
+//=============================================================================
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#include "jnipp.hpp"
+
+namespace {
+    // Keep the optimizer from folding the loops away.
+    volatile int sink;
+    volatile int fail_every = 16;
+
+    using expected_int = ornew::expected<int, ornew::error::runtime_error>;
+
+    __attribute__((noinline)) expected_int by_expected(int i){
+        if(i % fail_every == 0){
+            return ornew::raise<ornew::error::runtime_error>("failed");
+        }
+        return i;
+    }
+    __attribute__((noinline)) int by_exception(int i){
+        if(i % fail_every == 0){
+            throw std::runtime_error{ "failed" };
+        }
+        return i;
+    }
+    __attribute__((noinline)) int by_code(int i, int* out){
+        if(i % fail_every == 0){
+            return -1;
+        }
+        *out = i;
+        return 0;
+    }
+
+    template<typename F>
+    void run(char const* name, int n, F&& f){
+        auto begin = std::chrono::steady_clock::now();
+        for(int i = 0; i < n; ++i){
+            f(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        std::printf("%-10s %8.3f ns/op\n", name, static_cast<double>(ns) / n);
+    }
+}
+
+int main(){
+    constexpr int n = 1 << 22;
+    run("expected", n, [](int i){
+        auto r = by_expected(i);
+        sink = r ? *r : -1;
+    });
+    run("exception", n, [](int i){
+        try{
+            sink = by_exception(i);
+        }catch(std::runtime_error const&){
+            sink = -1;
+        }
+    });
+    run("code", n, [](int i){
+        int v;
+        sink = by_code(i, &v) == 0 ? v : -1;
+    });
+}
@@ -0,0 +1,208 @@
+//=============================================================================
+//! \file    jnipp/bench/jvm_bench.cpp
+//! \brief   jnipp vs. raw JNI on an embedded JVM
+//!
+//! Build:   javac -d bench bench/JnippBench.java
+//!          c++ -O2 -std=c++14 -I src -I $JAVA_HOME/include
+//!              -I $JAVA_HOME/include/linux bench/jvm_bench.cpp
+//!              -L $JAVA_HOME/lib/server -ljvm -o jvm_bench
+//! Run:     LD_LIBRARY_PATH=$JAVA_HOME/lib/server ./jvm_bench bench
+//!
+//! Prints one JSON object per line:
+//!   {"op":"call_int","impl":"jnipp","iterations":1000000,"ns_per_op":4.2}
+//=============================================================================
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "jnipp.hpp"
+#include "jnipp_soa.hpp"
+
+namespace {
+    volatile long sink;
+
+    template<typename F>
+    void run(char const* op, char const* impl, long n, F&& f){
+        for(long i = 0; i < n / 10; ++i){
+            f();
+        }
+        auto begin = std::chrono::steady_clock::now();
+        for(long i = 0; i < n; ++i){
+            f();
+        }
+        auto end = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        std::printf("{\"op\":\"%s\",\"impl\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.3f}\n",
+            op, impl, n, static_cast<double>(ns) / static_cast<double>(n));
+    }
+
+    // Every benchmark needs its method or field; a missing one is fatal.
+    template<typename T>
+    T require(jnipp::jni_expected<T> r, char const* what){
+        if(!r){
+            std::fprintf(stderr, "%s: %s\n", what, r.error().describe().c_str());
+            std::abort();
+        }
+        return *r;
+    }
+
+    int bench(JNIEnv* raw){
+        constexpr long n = 1000000;
+        constexpr long lookups = 100000;
+        jnipp::environment env{ raw };
+
+        auto cls = env.find_class("JnippBench");
+        if(!cls){
+            std::fprintf(stderr, "%s\n", cls.error().describe().c_str());
+            return 1;
+        }
+        jclass c = cls->get();
+        jobject obj = raw->AllocObject(c);
+        raw->CallVoidMethod(obj, raw->GetMethodID(c, "<init>", "()V"));
+
+        run("find_class", "raw", lookups, [&]{
+            jclass k = raw->FindClass("JnippBench");
+            raw->DeleteLocalRef(k);
+        });
+        run("find_class", "jnipp", lookups, [&]{
+            auto k = env.find_class("JnippBench");
+            raw->DeleteLocalRef(k ? k->get() : NULL);
+        });
+        run("get_method", "raw", lookups, [&]{
+            sink = reinterpret_cast<long>(raw->GetMethodID(c, "getI", "()I"));
+        });
+        run("get_method", "jnipp", lookups, [&]{
+            auto m = cls->get_method<std::int32_t()>("getI");
+            sink = m.has_value();
+        });
+
+#define JNIPP_BENCH_CALL(op, cpp, name, getter, sig) { \
+            jmethodID id = raw->GetMethodID(c, getter, sig); \
+            auto m = require(cls->get_method<cpp()>(getter), getter); \
+            run(op, "raw", n, [&]{ sink = static_cast<long>(raw->Call##name##Method(obj, id)); }); \
+            run(op, "jnipp", n, [&]{ sink = static_cast<long>(m(obj)); }); }
+        JNIPP_BENCH_CALL("call_boolean", bool, Boolean, "getZ", "()Z")
+        JNIPP_BENCH_CALL("call_byte", char, Byte, "getB", "()B")
+        JNIPP_BENCH_CALL("call_char", unsigned char, Char, "getC", "()C")
+        JNIPP_BENCH_CALL("call_short", std::int16_t, Short, "getS", "()S")
+        JNIPP_BENCH_CALL("call_int", std::int32_t, Int, "getI", "()I")
+        JNIPP_BENCH_CALL("call_long", std::int64_t, Long, "getJ", "()J")
+        JNIPP_BENCH_CALL("call_float", float, Float, "getF", "()F")
+        JNIPP_BENCH_CALL("call_double", double, Double, "getD", "()D")
+#undef JNIPP_BENCH_CALL
+        {
+            jmethodID id = raw->GetMethodID(c, "getV", "()V");
+            auto m = require(cls->get_method<void()>("getV"), "getV");
+            run("call_void", "raw", n, [&]{ raw->CallVoidMethod(obj, id); });
+            run("call_void", "jnipp", n, [&]{ m(obj); });
+            auto checked = require(cls->get_method<void(), jnipp::check::immediate>("getV"), "getV");
+            run("call_void_checked", "jnipp", n, [&]{ sink = checked(obj).has_value(); });
+            run("call_void_checked", "raw", n, [&]{
+                raw->CallVoidMethod(obj, id);
+                sink = raw->ExceptionCheck();
+            });
+        }
+        {
+            jmethodID id = raw->GetMethodID(c, "getL", "()Ljava/lang/Object;");
+            jnipp::method<jobject> m{ raw, id };
+            run("call_object", "raw", n, [&]{ raw->DeleteLocalRef(raw->CallObjectMethod(obj, id)); });
+            run("call_object", "jnipp", n, [&]{ raw->DeleteLocalRef(m(obj)); });
+        }
+
+#define JNIPP_BENCH_FIELD(type, cpp, name, field, sig, value) { \
+            jfieldID id = raw->GetFieldID(c, field, sig); \
+            auto f = require(cls->get_field<cpp>(field), field); \
+            run("get_field_" type, "raw", n, [&]{ sink = static_cast<long>(raw->Get##name##Field(obj, id)); }); \
+            run("get_field_" type, "jnipp", n, [&]{ sink = static_cast<long>(f.get(obj)); }); \
+            run("set_field_" type, "raw", n, [&]{ raw->Set##name##Field(obj, id, value); }); \
+            run("set_field_" type, "jnipp", n, [&]{ f.set(obj, value); }); }
+        JNIPP_BENCH_FIELD("boolean", bool, Boolean, "z", "Z", JNI_TRUE)
+        JNIPP_BENCH_FIELD("byte", char, Byte, "b", "B", 1)
+        JNIPP_BENCH_FIELD("char", unsigned char, Char, "c", "C", 'c')
+        JNIPP_BENCH_FIELD("short", std::int16_t, Short, "s", "S", 2)
+        JNIPP_BENCH_FIELD("int", std::int32_t, Int, "i", "I", 3)
+        JNIPP_BENCH_FIELD("long", std::int64_t, Long, "j", "J", 4)
+        JNIPP_BENCH_FIELD("float", float, Float, "f", "F", 5.0f)
+        JNIPP_BENCH_FIELD("double", double, Double, "d", "D", 6.0)
+#undef JNIPP_BENCH_FIELD
+        {
+            jfieldID id = raw->GetFieldID(c, "text", "Ljava/lang/String;");
+            auto f = require(cls->get_field<::jstring>("text"), "text");
+            run("get_field_string", "raw", n, [&]{ raw->DeleteLocalRef(raw->GetObjectField(obj, id)); });
+            run("get_field_string", "jnipp", n, [&]{ raw->DeleteLocalRef(f.get(obj)); });
+        }
+
+        {
+            auto text = static_cast<::jstring>(raw->GetObjectField(obj,
+                raw->GetFieldID(c, "text", "Ljava/lang/String;")));
+            run("string_to_native", "raw", n, [&]{
+                char const* chars = raw->GetStringUTFChars(text, NULL);
+                sink = chars[0];
+                raw->ReleaseStringUTFChars(text, chars);
+            });
+            run("string_to_native", "jnipp", n, [&]{
+                jnipp::utf_string s{ raw, text };
+                sink = s.c_str()[0];
+            });
+            std::string native = "jnipp benchmark string";
+            run("string_to_java", "raw", n, [&]{
+                raw->DeleteLocalRef(raw->NewStringUTF(native.c_str()));
+            });
+            run("string_to_java", "jnipp", n, [&]{
+                raw->DeleteLocalRef(jnipp::marshal<std::string>::to_jni(raw, native));
+            });
+            raw->DeleteLocalRef(text);
+        }
+
+        // A 64-element array to Java: raw JNI, and the soa::array_of
+        // operations struct-of-arrays marshalling uses.
+#define JNIPP_BENCH_ARRAY(type, jtype, name) { \
+            jtype values[64] = {}; \
+            run("array_to_java_" type "_64", "raw", n, [&]{ \
+                jtype##Array a = raw->New##name##Array(64); \
+                raw->Set##name##ArrayRegion(a, 0, 64, values); \
+                raw->DeleteLocalRef(a); \
+            }); \
+            run("array_to_java_" type "_64", "jnipp", n, [&]{ \
+                using array = jnipp::soa::array_of<jtype>; \
+                auto a = array::create(raw, 64); \
+                array::set(raw, a, 64, values); \
+                raw->DeleteLocalRef(a); \
+            }); }
+        JNIPP_BENCH_ARRAY("boolean", jboolean, Boolean)
+        JNIPP_BENCH_ARRAY("byte", jbyte, Byte)
+        JNIPP_BENCH_ARRAY("char", jchar, Char)
+        JNIPP_BENCH_ARRAY("short", jshort, Short)
+        JNIPP_BENCH_ARRAY("int", jint, Int)
+        JNIPP_BENCH_ARRAY("long", jlong, Long)
+        JNIPP_BENCH_ARRAY("float", jfloat, Float)
+        JNIPP_BENCH_ARRAY("double", jdouble, Double)
+#undef JNIPP_BENCH_ARRAY
+
+        raw->DeleteLocalRef(obj);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv){
+    std::string classpath = std::string("-Djava.class.path=") + (argc > 1 ? argv[1] : ".");
+    JavaVMOption options[1];
+    options[0].optionString = const_cast<char*>(classpath.c_str());
+    options[0].extraInfo = NULL;
+    JavaVMInitArgs args;
+    args.version = JNI_VERSION_1_6;
+    args.nOptions = 1;
+    args.options = options;
+    args.ignoreUnrecognized = JNI_FALSE;
+
+    JavaVM* vm;
+    JNIEnv* env;
+    if(JNI_CreateJavaVM(&vm, reinterpret_cast<void**>(&env), &args) != JNI_OK){
+        std::fprintf(stderr, "JNI_CreateJavaVM failed\n");
+        return 1;
+    }
+    int r = bench(env);
+    vm->DestroyJavaVM();
+    return r;
+}
@@ -17,90 +17,267 @@
 #ifndef JNIPP_JNIPP_HPP
 #define JNIPP_JNIPP_HPP
 
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
-#include <memory>
+#include <new>
+#include <utility>
 
 #include <jni.h>
 
+#ifdef JNIPP_ENABLE_STATS
+#include "jnipp_stats.hpp"
+#define JNIPP_STATS_SCOPE(operation, id) \
+    ::jnipp::stats::scope jnipp_stats_scope{ ::jnipp::stats::op::operation, id }
+#else
+#define JNIPP_STATS_SCOPE(operation, id)
+#endif
+
+#ifdef JNIPP_ENABLE_TRACE
+#include "jnipp_trace.hpp"
+#define JNIPP_TRACE_SCOPE(where) \
+    ::jnipp::trace::scope jnipp_trace_scope{ where }
+#else
+#define JNIPP_TRACE_SCOPE(where)
+#endif
+
+#ifdef JNIPP_ENABLE_LOOKUP_PROFILE
+#include "jnipp_lookup_profile.hpp"
+#define JNIPP_LOOKUP_SCOPE(what, clas, name, signature) \
+    ::jnipp::lookup_profile::scope jnipp_lookup_scope{ ::jnipp::lookup_profile::kind::what, clas, name, signature }
+#else
+#define JNIPP_LOOKUP_SCOPE(what, clas, name, signature)
+#endif
+
+#ifdef JNIPP_ENABLE_WARMUP
+#include "jnipp_warmup.hpp"
+#endif
+
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+#include "jnipp_memory.hpp"
+#define JNIPP_MEMORY_ACQUIRE(what, bytes) ::jnipp::memory::acquire(::jnipp::memory::what, bytes)
+#define JNIPP_MEMORY_RELEASE(what, bytes) ::jnipp::memory::release(::jnipp::memory::what, bytes)
+#else
+#define JNIPP_MEMORY_ACQUIRE(what, bytes)
+#define JNIPP_MEMORY_RELEASE(what, bytes)
+#endif
+
+// These need to know which class a method or field was looked up on.
+#if defined(JNIPP_ENABLE_STATS) || defined(JNIPP_ENABLE_TRACE) || defined(JNIPP_ENABLE_LOOKUP_PROFILE) || defined(JNIPP_ENABLE_WARMUP)
+#include "jnipp_names.hpp"
+#define JNIPP_CLASS_NAMES
+#endif
+
 namespace ornew {
     struct constructor_tag {
     };
     static constexpr constructor_tag constructor = {};
     template<typename Type>
+    struct is_trivial_storage
+        : std::integral_constant<bool,
+            std::is_trivially_copyable<Type>::value &&
+            std::is_trivially_destructible<Type>::value> {
+    };
+    template<typename Type, bool = is_trivial_storage<Type>::value>
     class storage {
     public:
         using type = Type;
-        using self = storage<type>;
+        using self = storage;
         using buffer = typename std::aligned_storage<sizeof(type), alignof(type)>::type;
     private:
         buffer buf;
         bool flag;
 
     public:
-        storage(std::nullptr_t)
+        storage(std::nullptr_t) noexcept
+            : flag{false} {
+        }
+        storage(self const& a) noexcept(std::is_nothrow_copy_constructible<type>::value)
             : flag{false} {
+            if(a.flag) emplace(*a.raw());
         }
-        storage(self const& a){
-            assign(*a.raw());
+        storage(self&& a) noexcept(std::is_nothrow_move_constructible<type>::value)
+            : flag{false} {
+            if(a.flag) emplace(std::move(*a.raw()));
         }
-        storage(type const& a){
-            assign(a);
+        storage(type const& a) noexcept(std::is_nothrow_copy_constructible<type>::value)
+            : flag{false} {
+            emplace(a);
+        }
+        storage(type&& a) noexcept(std::is_nothrow_move_constructible<type>::value)
+            : flag{false} {
+            emplace(std::move(a));
         }
         template<typename... Args>
-        storage(constructor_tag, Args&&... a){
-            construct(std::forward<Args>(a)...);
+        storage(constructor_tag, Args&&... a) noexcept(std::is_nothrow_constructible<type, Args&&...>::value)
+            : flag{false} {
+            emplace(std::forward<Args>(a)...);
         }
         ~storage(){
             destruct();
         }
-        type const* raw() const
+        type const* raw() const noexcept
         {
             // type erasure and force cast
             return static_cast<type const*>(static_cast<void const*>(&buf));
         }
-        type* raw()
+        type* raw() noexcept
         {
             // type erasure and force cast
             return static_cast<type*>(static_cast<void*>(&buf));
         }
+        bool constructed() const noexcept {
+            return flag;
+        }
         template<typename... Args>
-        self const& construct(Args&&... a){
+        self const& construct(Args&&... a) noexcept(std::is_nothrow_constructible<type, Args&&...>::value){
             destruct();
-            new(raw()) type(std::forward<Args>(a)...);
-            flag = true;
+            emplace(std::forward<Args>(a)...);
             return *this;
         }
-        void destruct(){
+        void destruct() noexcept {
             if(flag){
                 raw()->~type();
                 flag = false;
             }
         }
-        void assign(type const& a){
-            destruct();
-            (*raw()) = a;
+        template<typename T>
+        void assign(T&& a) noexcept(
+                std::is_nothrow_constructible<type, T&&>::value &&
+                std::is_nothrow_assignable<type&, T&&>::value){
+            if(flag) (*raw()) = std::forward<T>(a);
+            else emplace(std::forward<T>(a));
+        }
+        self& operator=(self const& a) noexcept(
+                std::is_nothrow_copy_constructible<type>::value &&
+                std::is_nothrow_copy_assignable<type>::value){
+            if(this != &a){
+                if(a.flag) assign(*a.raw());
+                else destruct();
+            }
+            return *this;
+        }
+        self& operator=(self&& a) noexcept(
+                std::is_nothrow_move_constructible<type>::value &&
+                std::is_nothrow_move_assignable<type>::value){
+            if(this != &a){
+                if(a.flag) assign(std::move(*a.raw()));
+                else destruct();
+            }
+            return *this;
+        }
+        void operator=(type const& a) noexcept(
+                std::is_nothrow_copy_constructible<type>::value &&
+                std::is_nothrow_copy_assignable<type>::value){
+            assign(a);
+        }
+        void operator=(type&& a) noexcept(
+                std::is_nothrow_move_constructible<type>::value &&
+                std::is_nothrow_move_assignable<type>::value){
+            assign(std::move(a));
+        }
+        type* operator ->() noexcept {
+            return raw();
+        }
+    private:
+        // Only where flag is already false, so nothing is read from buf.
+        template<typename... Args>
+        void emplace(Args&&... a){
+            new(raw()) type(std::forward<Args>(a)...);
+            flag = true;
+        }
+    };
+    // Trivial types need neither the flag nor a destructor, so the storage
+    // is exactly as large as the type and copies are plain memcpy. The
+    // members and their noexcept match the generic storage; test/expected.cpp
+    // checks both side by side.
+    template<typename Type>
+    class storage<Type, true> {
+    public:
+        using type = Type;
+        using self = storage;
+        using buffer = typename std::aligned_storage<sizeof(type), alignof(type)>::type;
+    private:
+        buffer buf;
+
+    public:
+        storage(std::nullptr_t) noexcept {
+        }
+        storage(self const&) = default;
+        storage(self&&) = default;
+        storage(type const& a) noexcept(std::is_nothrow_copy_constructible<type>::value) {
+            construct(a);
+        }
+        storage(type&& a) noexcept(std::is_nothrow_move_constructible<type>::value) {
+            construct(std::move(a));
+        }
+        template<typename... Args>
+        storage(constructor_tag, Args&&... a) noexcept(std::is_nothrow_constructible<type, Args&&...>::value) {
+            construct(std::forward<Args>(a)...);
+        }
+        ~storage() = default;
+        type const* raw() const noexcept
+        {
+            return static_cast<type const*>(static_cast<void const*>(&buf));
+        }
+        type* raw() noexcept
+        {
+            return static_cast<type*>(static_cast<void*>(&buf));
+        }
+        // Not tracked, since nothing needs destroying: the owner knows
+        // whether a value was stored, as expected does with its ok flag.
+        bool constructed() const noexcept {
+            return true;
+        }
+        template<typename... Args>
+        self const& construct(Args&&... a) noexcept(std::is_nothrow_constructible<type, Args&&...>::value){
+            new(raw()) type(std::forward<Args>(a)...);
+            return *this;
+        }
+        void destruct() noexcept {
         }
-        void operator=(type const& a){
+        template<typename T>
+        void assign(T&& a) noexcept(
+                std::is_nothrow_constructible<type, T&&>::value &&
+                std::is_nothrow_assignable<type&, T&&>::value){
+            construct(std::forward<T>(a));
+        }
+        self& operator=(self const&) = default;
+        self& operator=(self&&) = default;
+        void operator=(type const& a) noexcept(
+                std::is_nothrow_copy_constructible<type>::value &&
+                std::is_nothrow_copy_assignable<type>::value){
             assign(a);
         }
-        type* operator ->(){
+        void operator=(type&& a) noexcept(
+                std::is_nothrow_move_constructible<type>::value &&
+                std::is_nothrow_move_assignable<type>::value){
+            assign(std::move(a));
+        }
+        type* operator ->() noexcept {
             return raw();
         }
     };
     namespace error {
+        // The message is a borrowed pointer, never copied, which keeps errors
+        // trivially copyable: pass a string literal, or storage that outlives
+        // every copy of the error. A std::string's c_str() or a stack buffer
+        // dangles as soon as it goes away.
         struct basic_error {
         private:
-            std::string _message;
+            char const* _message;
         public:
-            basic_error(){}
-            template<typename String>
-            basic_error(String&& m)
-                :_message{ std::forward<String>(m) }{
+            constexpr basic_error() noexcept
+                :_message{ "" }{
+            }
+            constexpr basic_error(char const* m) noexcept
+                :_message{ m }{
             }
 
-            std::string const& get_message() const {
+            char const* get_message() const noexcept {
                 return _message;
             }
         };
@@ -108,7 +285,7 @@ namespace ornew {
             :public basic_error {
         public:
             template<typename... A>
-            runtime_error(A... a)
+            constexpr runtime_error(A&&... a) noexcept
                 : basic_error{ std::forward<A>(a)... } {
             }
         };
@@ -120,40 +297,254 @@ namespace ornew {
     public:
         using error = Error;
     private:
-        std::unique_ptr<error> e;
+        error e;
 
     public:
         template<typename... E>
-        unexpected(E&&... e)
-            : e{ new Error{ std::forward<E>(e)... } }
+        constexpr unexpected(E&&... e)
+            : e{ std::forward<E>(e)... }
         {}
-        std::unique_ptr<error> move_error(){
+        error&& move_error() noexcept {
             return std::move(e);
         }
     };
+    namespace detail {
+        struct value_tag {};
+        struct error_tag {};
+
+        template<typename Result, typename Error, bool =
+            is_trivial_storage<Result>::value && is_trivial_storage<Error>::value>
+        struct expected_storage {
+            union {
+                Result r;
+                Error e;
+            };
+            bool ok;
+
+            template<typename... A>
+            expected_storage(value_tag, A&&... a)
+                : r(std::forward<A>(a)...), ok{ true }{
+            }
+            template<typename... A>
+            expected_storage(error_tag, A&&... a)
+                : e(std::forward<A>(a)...), ok{ false }{
+            }
+            expected_storage(expected_storage const& a)
+                : ok{ a.ok }{
+                if(ok) new(&r) Result(a.r);
+                else new(&e) Error(a.e);
+            }
+            expected_storage(expected_storage&& a) noexcept(
+                    std::is_nothrow_move_constructible<Result>::value &&
+                    std::is_nothrow_move_constructible<Error>::value)
+                : ok{ a.ok }{
+                if(ok) new(&r) Result(std::move(a.r));
+                else new(&e) Error(std::move(a.e));
+            }
+            ~expected_storage(){
+                destruct();
+            }
+            expected_storage& operator=(expected_storage const& a){
+                if(this != &a){
+                    if(ok){
+                        if(a.ok) replace(r, r, a.r);
+                        else replace(r, e, a.e);
+                    }
+                    else{
+                        if(a.ok) replace(e, r, a.r);
+                        else replace(e, e, a.e);
+                    }
+                    ok = a.ok;
+                }
+                return *this;
+            }
+            expected_storage& operator=(expected_storage&& a) noexcept(
+                    std::is_nothrow_move_constructible<Result>::value &&
+                    std::is_nothrow_move_constructible<Error>::value){
+                if(this != &a){
+                    if(ok){
+                        if(a.ok) replace(r, r, std::move(a.r));
+                        else replace(r, e, std::move(a.e));
+                    }
+                    else{
+                        if(a.ok) replace(e, r, std::move(a.r));
+                        else replace(e, e, std::move(a.e));
+                    }
+                    ok = a.ok;
+                }
+                return *this;
+            }
+            void destruct() noexcept {
+                if(ok) r.~Result();
+                else e.~Error();
+            }
+
+        private:
+            // Destroys old and builds fresh, which may be the same member,
+            // so that a throwing constructor leaves old as it was.
+            template<typename Old, typename New, typename... A>
+            static void replace(Old& old, New& fresh, A&&... a){
+                replace(std::is_nothrow_move_constructible<New>{}, old, fresh, std::forward<A>(a)...);
+            }
+            // Built aside first; only the noexcept move follows the destruction.
+            template<typename Old, typename New, typename... A>
+            static void replace(std::true_type, Old& old, New& fresh, A&&... a){
+                New built(std::forward<A>(a)...);
+                old.~Old();
+                new(&fresh) New(std::move(built));
+            }
+            // New cannot be moved without throwing, so old is kept aside
+            // instead and put back if building New throws.
+            template<typename Old, typename New, typename... A>
+            static void replace(std::false_type, Old& old, New& fresh, A&&... a){
+                static_assert(std::is_nothrow_move_constructible<Old>::value,
+                    "ornew::expected needs Result or Error to be nothrow move constructible.");
+                Old kept(std::move(old));
+                old.~Old();
+                try{
+                    new(&fresh) New(std::forward<A>(a)...);
+                }catch(...){
+                    new(&old) Old(std::move(kept));
+                    throw;
+                }
+            }
+        };
+        // Both alternatives trivial: the union is trivially copyable and
+        // destructible, so expected<clas> and expected<method<T>> are too.
+        template<typename Result, typename Error>
+        struct expected_storage<Result, Error, true> {
+            union {
+                Result r;
+                Error e;
+            };
+            bool ok;
+
+            template<typename... A>
+            constexpr expected_storage(value_tag, A&&... a)
+                : r(std::forward<A>(a)...), ok{ true }{
+            }
+            template<typename... A>
+            constexpr expected_storage(error_tag, A&&... a)
+                : e(std::forward<A>(a)...), ok{ false }{
+            }
+        };
+    }
     template<typename Result, typename Error>
     class expected {
     public:
-        using error = Error;
+        using error_type = Error;
         using result = Result;
 
     private:
-        std::unique_ptr<error> e;
-        storage<result> r;
+        detail::expected_storage<result, error_type> s;
 
     public:
-        expected()
-            : r{ nullptr }{
+        expected(result const& a)
+            : s{ detail::value_tag{}, a }{
+        }
+        expected(result&& a) noexcept(std::is_nothrow_move_constructible<result>::value)
+            : s{ detail::value_tag{}, std::move(a) }{
         }
-        expected(storage<result> a)
-            : r{ a }{
+        expected(unexpected<error_type>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value)
+            : s{ detail::error_tag{}, u.move_error() }{
+        }
+
+        bool has_value() const noexcept {
+            return s.ok;
         }
-        expected(result a)
-            : r{ a }{
+        explicit operator bool() const noexcept {
+            return s.ok;
         }
-        expected(unexpected<error>&& e)
-            : r{ nullptr }{
-            this->e = std::move(e.move_error());
+        // value() and error() are unchecked, like operator* of std::optional.
+        result& value() & noexcept { return s.r; }
+        result const& value() const& noexcept { return s.r; }
+        result&& value() && noexcept { return std::move(s.r); }
+        result& operator*() & noexcept { return s.r; }
+        result const& operator*() const& noexcept { return s.r; }
+        result* operator->() noexcept { return &s.r; }
+        result const* operator->() const noexcept { return &s.r; }
+        error_type& error() & noexcept { return s.e; }
+        error_type const& error() const& noexcept { return s.e; }
+        error_type&& error() && noexcept { return std::move(s.e); }
+        template<typename U>
+        result value_or(U&& u) const& {
+            return s.ok ? s.r : static_cast<result>(std::forward<U>(u));
+        }
+
+        // f: result -> expected<U, error_type>
+        template<typename F>
+        auto and_then(F&& f) & -> decltype(f(s.r)) {
+            if(s.ok) return f(s.r);
+            return unexpected<error_type>{ s.e };
+        }
+        template<typename F>
+        auto and_then(F&& f) && -> decltype(f(std::move(s.r))) {
+            if(s.ok) return f(std::move(s.r));
+            return unexpected<error_type>{ std::move(s.e) };
+        }
+        // f: result -> U
+        template<typename F>
+        auto map(F&& f) & -> expected<std::decay_t<decltype(f(s.r))>, error_type> {
+            if(s.ok) return f(s.r);
+            return unexpected<error_type>{ s.e };
+        }
+        template<typename F>
+        auto map(F&& f) && -> expected<std::decay_t<decltype(f(std::move(s.r)))>, error_type> {
+            if(s.ok) return f(std::move(s.r));
+            return unexpected<error_type>{ std::move(s.e) };
+        }
+        // f: error_type -> expected<result, error_type>
+        template<typename F>
+        expected or_else(F&& f) & {
+            if(s.ok) return *this;
+            return f(s.e);
+        }
+        template<typename F>
+        expected or_else(F&& f) && {
+            if(s.ok) return std::move(*this);
+            return f(std::move(s.e));
+        }
+    };
+    template<typename Error>
+    class expected<void, Error> {
+    public:
+        using error_type = Error;
+        using result = void;
+
+    private:
+        storage<error_type> e;
+        bool ok;
+
+    public:
+        expected() noexcept
+            : e{ nullptr }, ok{ true }{
+        }
+        expected(unexpected<error_type>&& u) noexcept(std::is_nothrow_move_constructible<error_type>::value)
+            : e{ constructor, u.move_error() }, ok{ false }{
+        }
+
+        bool has_value() const noexcept {
+            return ok;
+        }
+        explicit operator bool() const noexcept {
+            return ok;
+        }
+        void value() const noexcept {}
+        error_type& error() & noexcept { return *e.raw(); }
+        error_type const& error() const& noexcept { return *e.raw(); }
+        error_type&& error() && noexcept { return std::move(*e.raw()); }
+
+        // f: () -> expected<U, error_type>
+        template<typename F>
+        auto and_then(F&& f) const& -> decltype(f()) {
+            if(ok) return f();
+            return unexpected<error_type>{ *e.raw() };
+        }
+        // f: error_type -> expected<void, error_type>
+        template<typename F>
+        expected or_else(F&& f) const& {
+            if(ok) return *this;
+            return f(*e.raw());
         }
     };
     template<typename Error, typename... Args>
@@ -163,19 +554,133 @@ namespace ornew {
 }
 
 namespace jnipp {
+    namespace detail {
+        inline std::string to_string(JNIEnv* env, ::jstring s){
+            std::string r;
+            if(s == NULL) return r;
+            char const* chars = env->GetStringUTFChars(s, NULL);
+            if(chars != NULL){
+                r = chars;
+                env->ReleaseStringUTFChars(s, chars);
+            }
+            return r;
+        }
+    }
+
+    namespace detail {
+        // printStackTrace() of t, or empty if it cannot be printed. Call
+        // with no exception pending; none is pending afterwards.
+        inline std::string stack_trace(JNIEnv* env, jthrowable t){
+            std::string s;
+            jclass writer_class = env->FindClass("java/io/StringWriter");
+            jclass printer_class = writer_class == NULL ? NULL : env->FindClass("java/io/PrintWriter");
+            jclass throwable_class = printer_class == NULL ? NULL : env->GetObjectClass(t);
+            // A failed lookup leaves NoSuchMethodError pending, so each one
+            // runs only after the previous succeeded.
+            jmethodID writer_init = throwable_class == NULL ? NULL :
+                env->GetMethodID(writer_class, "<init>", "()V");
+            jmethodID printer_init = writer_init == NULL ? NULL :
+                env->GetMethodID(printer_class, "<init>", "(Ljava/io/Writer;)V");
+            jmethodID print = printer_init == NULL ? NULL :
+                env->GetMethodID(throwable_class, "printStackTrace", "(Ljava/io/PrintWriter;)V");
+            jmethodID to_string_id = print == NULL ? NULL :
+                env->GetMethodID(writer_class, "toString", "()Ljava/lang/String;");
+            jobject writer = to_string_id == NULL ? NULL : env->NewObject(writer_class, writer_init);
+            jobject printer = writer == NULL ? NULL : env->NewObject(printer_class, printer_init, writer);
+            if(printer != NULL){
+                env->CallVoidMethod(t, print, printer);
+                auto trace = env->ExceptionCheck() == JNI_TRUE ? NULL :
+                    static_cast<::jstring>(env->CallObjectMethod(writer, to_string_id));
+                if(env->ExceptionCheck() == JNI_FALSE){
+                    s = to_string(env, trace);
+                }
+                env->DeleteLocalRef(trace);
+            }
+            env->ExceptionClear();
+            env->DeleteLocalRef(printer);
+            env->DeleteLocalRef(writer);
+            env->DeleteLocalRef(throwable_class);
+            env->DeleteLocalRef(printer_class);
+            env->DeleteLocalRef(writer_class);
+            return s;
+        }
+        // Throwable.toString() of t, e.g. "java.lang.NoSuchMethodError: run".
+        // Same contract as stack_trace().
+        inline std::string throwable_string(JNIEnv* env, jthrowable t){
+            std::string s;
+            jclass throwable_class = env->FindClass("java/lang/Throwable");
+            if(throwable_class != NULL){
+                jmethodID to_string_id = env->GetMethodID(throwable_class, "toString", "()Ljava/lang/String;");
+                auto text = to_string_id == NULL ? NULL : static_cast<::jstring>(env->CallObjectMethod(t, to_string_id));
+                if(env->ExceptionCheck() == JNI_FALSE){
+                    s = to_string(env, text);
+                }
+                env->DeleteLocalRef(text);
+            }
+            env->ExceptionClear();
+            env->DeleteLocalRef(throwable_class);
+            return s;
+        }
+    }
+
+    // Passed first by callers that already know an exception is pending, so
+    // the error path does not ask the VM again.
+    struct exception_pending_t {};
+    constexpr exception_pending_t exception_pending{};
+
+    // Construction only asks the VM whether an exception is pending; the
+    // throwable itself is fetched and formatted when describe() is called.
+    // Lookup errors keep a static message: the class, method or field that
+    // was not found is named by the pending exception, so by describe().
     struct jni_error
         : public ornew::error::runtime_error {
     private:
         JNIEnv* env;
+        bool pending;
 
     public:
         template<typename... Args>
-        jni_error(JNIEnv* env, Args&&... a): env{ env }, ornew::error::runtime_error{ std::forward<Args>(a)... }{}
+        jni_error(JNIEnv* env, Args&&... a) noexcept
+            : ornew::error::runtime_error{ std::forward<Args>(a)... }, env{ env },
+              pending{ env != NULL && env->ExceptionCheck() == JNI_TRUE }{}
+        template<typename... Args>
+        jni_error(JNIEnv* env, exception_pending_t, Args&&... a) noexcept
+            : ornew::error::runtime_error{ std::forward<Args>(a)... }, env{ env }, pending{ true }{}
+        JNIEnv* get_env() const noexcept {
+            return env;
+        }
+        bool has_exception() const noexcept {
+            return pending;
+        }
+        // Local reference to the pending throwable, or NULL.
+        jthrowable get_exception() const {
+            return pending ? env->ExceptionOccurred() : NULL;
+        }
+        std::string describe() const;
         void fatal(){
-            env->FatalError(get_message().c_str());
+            env->FatalError(describe().c_str());
         }
     };
 
+    // Message followed by the Java stack trace of the pending exception, or
+    // by its toString() where no stack trace can be printed. The exception
+    // is still pending afterwards.
+    inline std::string jni_error::describe() const {
+        std::string s = get_message();
+        jthrowable t = get_exception();
+        if(t == NULL) return s;
+        env->ExceptionClear();
+        auto trace = detail::stack_trace(env, t);
+        if(trace.empty()) trace = detail::throwable_string(env, t);
+        if(!trace.empty()){
+            s += "\n";
+            s += trace;
+        }
+        env->Throw(t);
+        env->DeleteLocalRef(t);
+        return s;
+    }
+
     template<typename T>
     using jni_expected = ornew::expected<T,jni_error>;
 
@@ -194,6 +699,22 @@ namespace jnipp {
     template <> struct resolver<std::int16_t> { using type = jshort; };
     template <> struct resolver<std::int32_t> { using type = jint; };
     template <> struct resolver<std::int64_t> { using type = jlong; };
+    template <> struct resolver<float> { using type = jfloat; };
+    template <> struct resolver<double> { using type = jdouble; };
+    // References pass through, as do their method and field types.
+    template <> struct resolver<jobject> { using type = jobject; };
+    template <> struct resolver<jclass> { using type = jclass; };
+    template <> struct resolver<::jstring> { using type = ::jstring; };
+    template <> struct resolver<jthrowable> { using type = jthrowable; };
+    template <> struct resolver<jbooleanArray> { using type = jbooleanArray; };
+    template <> struct resolver<jbyteArray> { using type = jbyteArray; };
+    template <> struct resolver<jcharArray> { using type = jcharArray; };
+    template <> struct resolver<jshortArray> { using type = jshortArray; };
+    template <> struct resolver<jintArray> { using type = jintArray; };
+    template <> struct resolver<jlongArray> { using type = jlongArray; };
+    template <> struct resolver<jfloatArray> { using type = jfloatArray; };
+    template <> struct resolver<jdoubleArray> { using type = jdoubleArray; };
+    template <> struct resolver<jobjectArray> { using type = jobjectArray; };
     template <typename Return, typename... Args> struct resolver<Return(Args...)> {
         using return_type = Return;
         using type = typename resolver<Return>::type(typename resolver<Args>::type...);
@@ -201,6 +722,24 @@ namespace jnipp {
 
     template <typename Type> using type = typename resolver<Type>::type;
 
+    // Java primitive of the same width as an arithmetic type, for values
+    // laid out in arrays, buffers and fields rather than passed to methods.
+    // Unsigned types map to the signed Java type of their width, except
+    // std::uint16_t, which is a char; void where Java has none.
+    template <typename Type> struct element { using type = void; };
+    template <> struct element<bool> { using type = jboolean; };
+    template <> struct element<char> { using type = jbyte; };
+    template <> struct element<std::int8_t> { using type = jbyte; };
+    template <> struct element<std::uint8_t> { using type = jbyte; };
+    template <> struct element<std::int16_t> { using type = jshort; };
+    template <> struct element<std::uint16_t> { using type = jchar; };
+    template <> struct element<std::int32_t> { using type = jint; };
+    template <> struct element<std::uint32_t> { using type = jint; };
+    template <> struct element<std::int64_t> { using type = jlong; };
+    template <> struct element<std::uint64_t> { using type = jlong; };
+    template <> struct element<float> { using type = jfloat; };
+    template <> struct element<double> { using type = jdouble; };
+
 
     namespace detail{
         inline void pack_to_string(std::string&)
@@ -256,9 +795,35 @@ namespace jnipp {
     template<> struct mangler<jchar>{ using name = pack<'C'>; };
     template<> struct mangler<jshort>{ using name = pack<'S'>; };
     template<> struct mangler<jint>{ using name = pack<'I'>; };
-    template<> struct mangler<jlong>{ using name = pack<'L'>; };
+    template<> struct mangler<jlong>{ using name = pack<'J'>; };
     template<> struct mangler<jfloat>{ using name = pack<'F'>; };
     template<> struct mangler<jdouble>{ using name = pack<'D'>; };
+    template<> struct mangler<void>{ using name = pack<'V'>; };
+
+    // Reference types as they appear in native method parameter lists.
+    template<> struct mangler<jobject>{
+        using name = pack<'L','j','a','v','a','/','l','a','n','g','/','O','b','j','e','c','t',';'>;
+    };
+    template<> struct mangler<jclass>{
+        using name = pack<'L','j','a','v','a','/','l','a','n','g','/','C','l','a','s','s',';'>;
+    };
+    template<> struct mangler<::jstring>{
+        using name = pack<'L','j','a','v','a','/','l','a','n','g','/','S','t','r','i','n','g',';'>;
+    };
+    template<> struct mangler<jthrowable>{
+        using name = pack<'L','j','a','v','a','/','l','a','n','g','/','T','h','r','o','w','a','b','l','e',';'>;
+    };
+    template<> struct mangler<jbooleanArray>{ using name = pack<'[','Z'>; };
+    template<> struct mangler<jbyteArray>{ using name = pack<'[','B'>; };
+    template<> struct mangler<jcharArray>{ using name = pack<'[','C'>; };
+    template<> struct mangler<jshortArray>{ using name = pack<'[','S'>; };
+    template<> struct mangler<jintArray>{ using name = pack<'[','I'>; };
+    template<> struct mangler<jlongArray>{ using name = pack<'[','J'>; };
+    template<> struct mangler<jfloatArray>{ using name = pack<'[','F'>; };
+    template<> struct mangler<jdoubleArray>{ using name = pack<'[','D'>; };
+    template<> struct mangler<jobjectArray>{
+        using name = pack_join<pack<'['>, mangler<jobject>::name>;
+    };
 
     template<typename L> struct mangler<defined<L>>{
         using name = pack_join_all<pack<'L'>, typename L::name, pack<';'>>;
@@ -282,6 +847,39 @@ namespace jnipp {
     template<typename Type>
     using mangle = typename mangler<Type>::name;
 
+    // Java signature of a native function: the leading JNIEnv* and
+    // jobject/jclass parameters are not part of it.
+    template<typename Function>
+    struct native_signature {};
+    template<typename Return, typename Self, typename... Args>
+    struct native_signature<Return (JNICALL *)(JNIEnv*, Self, Args...)> {
+        static_assert(std::is_same<Self, jobject>::value || std::is_same<Self, jclass>::value,
+            "The second parameter of a native method must be jobject or jclass.");
+        using name = mangle<Return(Args...)>;
+    };
+#ifdef __cpp_noexcept_function_type
+    // Since C++17 noexcept is part of the type, e.g. of trampoline::call.
+    template<typename Return, typename Self, typename... Args>
+    struct native_signature<Return (JNICALL *)(JNIEnv*, Self, Args...) noexcept>
+        : native_signature<Return (JNICALL *)(JNIEnv*, Self, Args...)> {
+    };
+#endif
+
+    // One RegisterNatives entry. The signature string is generated at
+    // compile time from the function type:
+    //
+    //   static JNINativeMethod const methods[] = {
+    //       jnipp::native_method("add", &add),
+    //   };
+    //   cls.register_natives(methods);
+    template<typename Function>
+    JNINativeMethod native_method(char const* name, Function* f) noexcept {
+        return JNINativeMethod{
+            const_cast<char*>(name),
+            const_cast<char*>(native_signature<Function*>::name::str),
+            reinterpret_cast<void*>(f) };
+    }
+
     struct jstring_define {
         using name = pack<'j','a','v','a','/','l','a','n','g','/','S','t','r','i','n','g'>;
     };
@@ -297,7 +895,10 @@ namespace jnipp {
     private:
         JNIEnv* env;
     public:
-        jni_expected<clas> find_class(std::string name);
+        environment(JNIEnv* env) noexcept
+            : env{env} {}
+        jni_expected<clas> find_class(char const* name);
+        jni_expected<clas> find_class(std::string const& name);
         // no const
         JNIEnv* attach() {
             return env;
@@ -305,21 +906,148 @@ namespace jnipp {
     };
     using env = environment;
 
+    // Exception-check policies for method<> and field<>.
+    //   immediate : ExceptionCheck after every call, results are jni_expected<T>.
+    //   deferred  : no check per call; an exception_scope checks once for the
+    //               whole sequence. JNI forbids further calls while an
+    //               exception is pending, so only batch calls not expected to
+    //               throw. Calls must be made inside a scope, and the scope
+    //               must be checked before it ends; debug builds assert both.
+    //   none      : never check, the caller guarantees the callee cannot throw.
+    namespace check {
+        struct none {
+            template<typename T>
+            using result = T;
+            template<typename F>
+            static auto invoke(JNIEnv*, F&& f){
+                return f();
+            }
+        };
+        struct deferred {
+            template<typename T>
+            using result = T;
+            template<typename F>
+            static auto invoke(JNIEnv*, F&& f);
+        };
+        struct immediate {
+            template<typename T>
+            using result = jni_expected<T>;
+            template<typename F>
+            static auto invoke(JNIEnv* env, F&& f){
+                return invoke(env, std::forward<F>(f), std::is_void<decltype(f())>{});
+            }
+
+        private:
+            template<typename F>
+            static jni_expected<void> invoke(JNIEnv* env, F&& f, std::true_type){
+                f();
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    return jni_raise(env, exception_pending, "Java exception thrown.");
+                }
+                return {};
+            }
+            template<typename F>
+            static jni_expected<decltype(std::declval<F&>()())> invoke(JNIEnv* env, F&& f, std::false_type){
+                auto r = f();
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    return jni_raise(env, exception_pending, "Java exception thrown.");
+                }
+                return r;
+            }
+        };
+    }
+
+    // Checks once for the calls made through check::deferred since the
+    // scope began. In debug builds the innermost scope on the thread records
+    // each deferred call, and its destructor asserts that check() was called
+    // after the last one; release builds keep no state beyond the env.
+    class exception_scope {
+    private:
+        JNIEnv* env;
+#ifndef NDEBUG
+        exception_scope* outer;
+        bool unchecked = false;
+        static exception_scope*& current() noexcept {
+            static thread_local exception_scope* scope = nullptr;
+            return scope;
+        }
+        friend struct check::deferred;
+#endif
+    public:
+        explicit exception_scope(environment& e) noexcept
+            : env{ e.attach() } {
+#ifndef NDEBUG
+            outer = current();
+            current() = this;
+#endif
+        }
+        ~exception_scope(){
+#ifndef NDEBUG
+            assert(!unchecked && "exception_scope ended without check() after a deferred call");
+            current() = outer;
+#endif
+        }
+        exception_scope(exception_scope const&) = delete;
+        exception_scope& operator=(exception_scope const&) = delete;
+        jni_expected<void> check() {
+#ifndef NDEBUG
+            unchecked = false;
+#endif
+            if(env->ExceptionCheck() == JNI_TRUE){
+                return jni_raise(env, exception_pending, "Java exception thrown in exception_scope.");
+            }
+            return {};
+        }
+    };
+
+    template<typename F>
+    auto check::deferred::invoke(JNIEnv*, F&& f){
+#ifndef NDEBUG
+        auto scope = exception_scope::current();
+        assert(scope != nullptr && "check::deferred call outside an exception_scope");
+        scope->unchecked = true;
+#endif
+        return f();
+    }
+
+    // Handles hold the JNIEnv* itself rather than the environment, so a call
+    // is a single indirect call through the function table.
     class method_id {
     protected:
-        environment* env;
-        jclass cls;
+        JNIEnv* env;
         jmethodID id;
+#ifdef JNIPP_ENABLE_TRACE
+        trace::site const* site = nullptr;
+#endif
     public:
-        method_id(environment* env, jclass c, jmethodID id)
-            : env{env}, cls{c}, id{id} {}
+        method_id(JNIEnv* env, jmethodID id) noexcept
+            : env{env}, id{id} {}
+        method_id(environment* env, jclass, jmethodID id) noexcept
+            : env{env->attach()}, id{id} {}
+        jmethodID get() const noexcept {
+            return id;
+        }
+        // Moves the handle to the thread that owns e; method IDs are valid
+        // on every thread, the JNIEnv is not.
+        void rebind(JNIEnv* e) noexcept {
+            env = e;
+        }
+#ifdef JNIPP_ENABLE_TRACE
+        void set_site(trace::site const* s) noexcept {
+            site = s;
+        }
+#endif
     };
-    template<typename>
+    template<typename, typename = check::none>
     class method;
 #define JNIPP_METHOD_MAP(type, name) \
-    template<> class method <type> : public method_id { \
-        public: template<typename... Args> type operator()(Args&&... a){ \
-            return env->attach()->Call##name##Method(cls, id, std::forward<Args>(a)...); } };
+    template<typename Policy> class method <type, Policy> : public method_id { \
+        public: using method_id::method_id; \
+        template<typename... Args> typename Policy::template result<type> operator()(jobject obj, Args&&... a){ \
+            JNIPP_STATS_SCOPE(call, id); \
+            JNIPP_TRACE_SCOPE(site); \
+            JNIEnv* e = env; \
+            return Policy::invoke(e, [&]{ return static_cast<type>(e->Call##name##Method(obj, id, std::forward<Args>(a)...)); }); } };
     JNIPP_METHOD_MAP(void, Void)
     JNIPP_METHOD_MAP(jboolean, Boolean)
     JNIPP_METHOD_MAP(jbyte, Byte)
@@ -329,30 +1057,430 @@ namespace jnipp {
     JNIPP_METHOD_MAP(jlong, Long)
     JNIPP_METHOD_MAP(jfloat, Float)
     JNIPP_METHOD_MAP(jdouble, Double)
+    JNIPP_METHOD_MAP(jobject, Object)
+    // Reference subtypes go through the Object call and are cast back.
+    JNIPP_METHOD_MAP(jclass, Object)
+    JNIPP_METHOD_MAP(::jstring, Object)
+    JNIPP_METHOD_MAP(jthrowable, Object)
+    JNIPP_METHOD_MAP(jbooleanArray, Object)
+    JNIPP_METHOD_MAP(jbyteArray, Object)
+    JNIPP_METHOD_MAP(jcharArray, Object)
+    JNIPP_METHOD_MAP(jshortArray, Object)
+    JNIPP_METHOD_MAP(jintArray, Object)
+    JNIPP_METHOD_MAP(jlongArray, Object)
+    JNIPP_METHOD_MAP(jfloatArray, Object)
+    JNIPP_METHOD_MAP(jdoubleArray, Object)
+    JNIPP_METHOD_MAP(jobjectArray, Object)
 #undef JNIPP_METHOD_MAP
 
+    class field_id {
+    protected:
+        JNIEnv* env;
+        jfieldID id;
+#ifdef JNIPP_ENABLE_TRACE
+        trace::site const* site = nullptr;
+#endif
+    public:
+        field_id(JNIEnv* env, jfieldID id) noexcept
+            : env{env}, id{id} {}
+        field_id(environment* env, jfieldID id) noexcept
+            : env{env->attach()}, id{id} {}
+        jfieldID get() const noexcept {
+            return id;
+        }
+#ifdef JNIPP_ENABLE_TRACE
+        void set_site(trace::site const* s) noexcept {
+            site = s;
+        }
+#endif
+    };
+    template<typename, typename = check::none>
+    class field;
+#define JNIPP_FIELD_MAP(type, name) \
+    template<typename Policy> class field <type, Policy> : public field_id { \
+        public: using field_id::field_id; \
+        typename Policy::template result<type> get(jobject obj){ \
+            JNIPP_TRACE_SCOPE(site); \
+            JNIEnv* e = env; \
+            return Policy::invoke(e, [&]{ return static_cast<type>(e->Get##name##Field(obj, id)); }); } \
+        typename Policy::template result<void> set(jobject obj, type value){ \
+            JNIPP_TRACE_SCOPE(site); \
+            JNIEnv* e = env; \
+            return Policy::invoke(e, [&]{ e->Set##name##Field(obj, id, value); }); } };
+    JNIPP_FIELD_MAP(jboolean, Boolean)
+    JNIPP_FIELD_MAP(jbyte, Byte)
+    JNIPP_FIELD_MAP(jchar, Char)
+    JNIPP_FIELD_MAP(jshort, Short)
+    JNIPP_FIELD_MAP(jint, Int)
+    JNIPP_FIELD_MAP(jlong, Long)
+    JNIPP_FIELD_MAP(jfloat, Float)
+    JNIPP_FIELD_MAP(jdouble, Double)
+    JNIPP_FIELD_MAP(jobject, Object)
+    JNIPP_FIELD_MAP(jclass, Object)
+    JNIPP_FIELD_MAP(::jstring, Object)
+    JNIPP_FIELD_MAP(jthrowable, Object)
+    JNIPP_FIELD_MAP(jbooleanArray, Object)
+    JNIPP_FIELD_MAP(jbyteArray, Object)
+    JNIPP_FIELD_MAP(jcharArray, Object)
+    JNIPP_FIELD_MAP(jshortArray, Object)
+    JNIPP_FIELD_MAP(jintArray, Object)
+    JNIPP_FIELD_MAP(jlongArray, Object)
+    JNIPP_FIELD_MAP(jfloatArray, Object)
+    JNIPP_FIELD_MAP(jdoubleArray, Object)
+    JNIPP_FIELD_MAP(jobjectArray, Object)
+#undef JNIPP_FIELD_MAP
+
     class clas {
     private:
-        environment* env;
+        JNIEnv* env;
         jclass c;
+#ifdef JNIPP_CLASS_NAMES
+        char const* name = "";
+#endif
     public:
-        clas(environment* env, jclass c): env{env}, c{c} {}
-        template<typename Signature, typename type = jnipp::type<Signature>>
-        auto get_method(std::string name) -> jni_expected<method<typename type::return_type>> {
-            auto id = env->attach()->GetMethodID(c, name.c_str(), mangle<type>::str);
+        clas(JNIEnv* env, jclass c) noexcept: env{env}, c{c} {}
+        clas(environment* env, jclass c) noexcept: env{env->attach()}, c{c} {}
+#ifdef JNIPP_CLASS_NAMES
+        void set_name(char const* n) noexcept {
+            name = n;
+        }
+#endif
+        template<typename Signature, typename Policy = check::none, typename type = jnipp::type<Signature>,
+            typename return_type = jnipp::type<typename resolver<Signature>::return_type>>
+        auto get_method(char const* name) -> jni_expected<method<return_type, Policy>> {
+            JNIPP_STATS_SCOPE(get_method, this->name);
+            JNIPP_LOOKUP_SCOPE(method, this->name, name, mangle<type>::str);
+#ifdef JNIPP_ENABLE_WARMUP
+            auto id = warmup::method(this->name, name, mangle<type>::str, [&]{
+                return env->GetMethodID(c, name, mangle<type>::str);
+            });
+#else
+            auto id = env->GetMethodID(c, name, mangle<type>::str);
+#endif
+            if(id == NULL){
+                return jni_raise(env, exception_pending, "Method not found in clas::get_method function; describe() names it.");
+            }
+            method<return_type, Policy> m{ env, id };
+#ifdef JNIPP_ENABLE_STATS
+            stats::label(id, this->name, name, mangle<type>::str);
+#endif
+#ifdef JNIPP_ENABLE_TRACE
+            m.set_site(trace::intern(this->name, name, mangle<type>::str));
+#endif
+            return m;
+        }
+        template<typename Signature, typename Policy = check::none>
+        auto get_method(std::string const& name){
+            return get_method<Signature, Policy>(name.c_str());
+        }
+        // The field lookup behind get_field, with its stats, profiling and
+        // warmup, for callers that keep bare IDs. NULL with the exception
+        // pending if there is no such field.
+        jfieldID lookup_field(char const* name, char const* signature){
+            JNIPP_STATS_SCOPE(get_field, this->name);
+            JNIPP_LOOKUP_SCOPE(field, this->name, name, signature);
+#ifdef JNIPP_ENABLE_WARMUP
+            return warmup::field(this->name, name, signature, [&]{
+                return env->GetFieldID(c, name, signature);
+            });
+#else
+            return env->GetFieldID(c, name, signature);
+#endif
+        }
+        template<typename Type, typename Policy = check::none, typename type = jnipp::type<Type>>
+        auto get_field(char const* name) -> jni_expected<field<type, Policy>> {
+            auto id = lookup_field(name, mangle<type>::str);
             if(id == NULL){
-                return jni_raise(env->attach(), "Not found: " + name + " in clas::get_method function.");
+                return jni_raise(env, exception_pending, "Field not found in clas::get_field function; describe() names it.");
+            }
+            field<type, Policy> f{ env, id };
+#ifdef JNIPP_ENABLE_TRACE
+            f.set_site(trace::intern(this->name, name, mangle<type>::str));
+#endif
+            return f;
+        }
+        template<typename Type, typename Policy = check::none>
+        auto get_field(std::string const& name){
+            return get_field<Type, Policy>(name.c_str());
+        }
+        jni_expected<void> register_natives(JNINativeMethod const* methods, jint count){
+            if(env->RegisterNatives(c, methods, count) != JNI_OK){
+                return jni_raise(env, "RegisterNatives failed in clas::register_natives function.");
             }
-            return method<typename type::return_type>{ env, c, id };
+            return {};
+        }
+        template<std::size_t N>
+        jni_expected<void> register_natives(JNINativeMethod const (&methods)[N]){
+            return register_natives(methods, static_cast<jint>(N));
+        }
+        jclass get() const noexcept {
+            return c;
+        }
+        JNIEnv* get_env() const noexcept {
+            return env;
         }
     };
 
-    jni_expected<clas> environment::find_class(std::string name){
-        jclass c = env->FindClass(name.c_str());
+    inline jni_expected<clas> environment::find_class(char const* name){
+#ifdef JNIPP_CLASS_NAMES
+        auto interned = names::intern(name);
+#endif
+        JNIPP_STATS_SCOPE(find_class, interned);
+        JNIPP_LOOKUP_SCOPE(clas, name, nullptr, nullptr);
+#ifdef JNIPP_ENABLE_WARMUP
+        jclass c = warmup::find_class(env, name, [&]{
+            return env->FindClass(name);
+        });
+#else
+        jclass c = env->FindClass(name);
+#endif
         if(c == NULL){
-            return jni_raise(env, "Not found: " + name + " in env::find_class function.");
+            return jni_raise(env, exception_pending, "Class not found in env::find_class function; describe() names it.");
+        }
+        clas k{ env, c };
+#ifdef JNIPP_CLASS_NAMES
+        k.set_name(interned);
+#endif
+        return k;
+    }
+    inline jni_expected<clas> environment::find_class(std::string const& name){
+        return find_class(name.c_str());
+    }
+
+    // Handles must stay as cheap to pass around as the raw JNI values.
+    static_assert(std::is_trivially_copyable<method<jint>>::value, "method<> must be trivially copyable");
+    static_assert(std::is_trivially_copyable<field<jint>>::value, "field<> must be trivially copyable");
+    static_assert(std::is_trivially_copyable<clas>::value, "clas must be trivially copyable");
+    static_assert(std::is_trivially_copyable<jni_expected<method<jint>>>::value, "jni_expected<method<>> must be trivially copyable");
+    static_assert(std::is_trivially_copyable<jni_expected<clas>>::value, "jni_expected<clas> must be trivially copyable");
+    // Trace builds add the call site to handles, and class names to clas.
+#ifndef JNIPP_ENABLE_TRACE
+    static_assert(sizeof(method<jint>) == sizeof(JNIEnv*) + sizeof(jmethodID), "method<> carries extra state");
+    static_assert(sizeof(field<jint>) == sizeof(JNIEnv*) + sizeof(jfieldID), "field<> carries extra state");
+#endif
+#ifndef JNIPP_CLASS_NAMES
+    static_assert(sizeof(clas) == sizeof(JNIEnv*) + sizeof(jclass), "clas carries extra state");
+#endif
+
+    // Global references to the throwable classes used when translating C++
+    // exceptions, so that the error path never calls FindClass. load() is
+    // meant for JNI_OnLoad, before any native method can run.
+    class throwable_classes {
+    public:
+        enum kind {
+            runtime_exception,
+            illegal_argument_exception,
+            index_out_of_bounds_exception,
+            out_of_memory_error,
+            error,
+            kind_count
+        };
+
+    private:
+        jclass classes[kind_count] = {};
+
+        static char const* name(kind k) noexcept {
+            static char const* const names[kind_count] = {
+                "java/lang/RuntimeException",
+                "java/lang/IllegalArgumentException",
+                "java/lang/IndexOutOfBoundsException",
+                "java/lang/OutOfMemoryError",
+                "java/lang/Error",
+            };
+            return names[k];
+        }
+
+    public:
+        static throwable_classes& instance() noexcept {
+            static throwable_classes c;
+            return c;
+        }
+        jni_expected<void> load(JNIEnv* env){
+            for(int k = 0; k < kind_count; ++k){
+                if(classes[k] != NULL) continue;
+                jclass local = env->FindClass(name(static_cast<kind>(k)));
+                if(local == NULL){
+                    return jni_raise(env, "Class not found in throwable_classes::load function; describe() names it.");
+                }
+                classes[k] = static_cast<jclass>(env->NewGlobalRef(local));
+                env->DeleteLocalRef(local);
+            }
+            return {};
+        }
+        void unload(JNIEnv* env) noexcept {
+            for(auto& c : classes){
+                if(c != NULL){
+                    env->DeleteGlobalRef(c);
+                    c = NULL;
+                }
+            }
+        }
+        // Falls back to FindClass when load() has not been called.
+        void throw_new(JNIEnv* env, kind k, char const* message) noexcept {
+            if(classes[k] != NULL){
+                env->ThrowNew(classes[k], message);
+                return;
+            }
+            jclass local = env->FindClass(name(k));
+            if(local != NULL){
+                env->ThrowNew(local, message);
+                env->DeleteLocalRef(local);
+            }
+        }
+    };
+
+    // Converts the exception currently being handled into a pending Java
+    // exception. Must be called from inside a catch block.
+    inline void translate_exception(JNIEnv* env) noexcept {
+        auto& classes = throwable_classes::instance();
+        try{
+            throw;
+        }catch(jni_error const& e){
+            // The Java exception behind it is already pending.
+            if(env->ExceptionCheck() == JNI_TRUE) return;
+            classes.throw_new(env, throwable_classes::runtime_exception, e.get_message());
+        }catch(std::bad_alloc const& e){
+            classes.throw_new(env, throwable_classes::out_of_memory_error, e.what());
+        }catch(std::invalid_argument const& e){
+            classes.throw_new(env, throwable_classes::illegal_argument_exception, e.what());
+        }catch(std::out_of_range const& e){
+            classes.throw_new(env, throwable_classes::index_out_of_bounds_exception, e.what());
+        }catch(std::exception const& e){
+            classes.throw_new(env, throwable_classes::runtime_exception, e.what());
+        }catch(...){
+            classes.throw_new(env, throwable_classes::error, "Unknown C++ exception.");
         }
-        return clas{ this, c };
     }
+
+    // Runs the body of a native method. C++ exceptions do not cross into the
+    // JVM; they become Java exceptions and a zero value is returned.
+    template<typename Function>
+    auto native_entry(JNIEnv* env, Function&& f) noexcept -> decltype(f()) {
+        try{
+            return f();
+        }catch(...){
+            translate_exception(env);
+        }
+        return decltype(f())();
+    }
+    // Modified UTF-8 view of a java.lang.String, released on destruction.
+    class utf_string {
+    private:
+        JNIEnv* env;
+        ::jstring s;
+        char const* chars;
+
+    public:
+        utf_string(JNIEnv* env, ::jstring s)
+            : env{ env }, s{ s }, chars{ s == NULL ? NULL : env->GetStringUTFChars(s, NULL) } {}
+        utf_string(utf_string&& a) noexcept
+            : env{ a.env }, s{ a.s }, chars{ a.chars } {
+            a.chars = NULL;
+        }
+        utf_string(utf_string const&) = delete;
+        utf_string& operator=(utf_string const&) = delete;
+        ~utf_string(){
+            if(chars != NULL){
+                env->ReleaseStringUTFChars(s, chars);
+            }
+        }
+        char const* c_str() const noexcept {
+            return chars == NULL ? "" : chars;
+        }
+        std::string str() const {
+            return c_str();
+        }
+        explicit operator bool() const noexcept {
+            return chars != NULL;
+        }
+    };
+
+    // Conversion between a C++ parameter or return type of a native
+    // function and the JNI type the JVM passes.
+    template<typename Type, typename = void>
+    struct marshal {
+        using jni_type = Type;
+        static Type from_jni(JNIEnv*, jni_type a) noexcept { return a; }
+        static jni_type to_jni(JNIEnv*, Type a) noexcept { return a; }
+    };
+    template<typename Type>
+    struct marshal<Type, std::enable_if_t<std::is_arithmetic<Type>::value>> {
+        using jni_type = jnipp::type<Type>;
+        static Type from_jni(JNIEnv*, jni_type a) noexcept { return static_cast<Type>(a); }
+        static jni_type to_jni(JNIEnv*, Type a) noexcept { return static_cast<jni_type>(a); }
+    };
+    // The JNI typedefs of the small primitives pass through as themselves:
+    // the resolver maps unsigned char (jboolean) to jchar and has no signed
+    // char (jbyte).
+#define JNIPP_MARSHAL_EXACT(type) \
+    template<> struct marshal<type> { \
+        using jni_type = type; \
+        static type from_jni(JNIEnv*, type a) noexcept { return a; } \
+        static type to_jni(JNIEnv*, type a) noexcept { return a; } };
+    JNIPP_MARSHAL_EXACT(jboolean)
+    JNIPP_MARSHAL_EXACT(jbyte)
+    JNIPP_MARSHAL_EXACT(jchar)
+    JNIPP_MARSHAL_EXACT(jshort)
+#undef JNIPP_MARSHAL_EXACT
+    template<>
+    struct marshal<void> {
+        using jni_type = void;
+    };
+    template<>
+    struct marshal<bool> {
+        using jni_type = jboolean;
+        static bool from_jni(JNIEnv*, jboolean a) noexcept { return a == JNI_TRUE; }
+        static jboolean to_jni(JNIEnv*, bool a) noexcept { return a ? JNI_TRUE : JNI_FALSE; }
+    };
+    template<>
+    struct marshal<utf_string> {
+        using jni_type = ::jstring;
+        static utf_string from_jni(JNIEnv* env, ::jstring a){ return utf_string{ env, a }; }
+    };
+    template<>
+    struct marshal<std::string> {
+        using jni_type = ::jstring;
+        static std::string from_jni(JNIEnv* env, ::jstring a){ return detail::to_string(env, a); }
+        static ::jstring to_jni(JNIEnv* env, std::string const& a){ return env->NewStringUTF(a.c_str()); }
+    };
+
+    namespace detail {
+        template<typename Return>
+        struct native_return {
+            template<typename F>
+            static typename marshal<Return>::jni_type call(JNIEnv* env, F&& f){
+                return marshal<Return>::to_jni(env, f());
+            }
+        };
+        template<>
+        struct native_return<void> {
+            template<typename F>
+            static void call(JNIEnv*, F&& f){
+                f();
+            }
+        };
+    }
+
+    // JNI entry point for a C++ function of the form
+    //   Return f(environment&, jobject or jclass, Args...)
+    // Arguments and the result go through marshal<>, and exceptions are
+    // translated by native_entry. Everything inlines into call().
+    template<typename Function, Function F>
+    struct trampoline {};
+    template<typename Return, typename Self, typename... Args, Return (*F)(environment&, Self, Args...)>
+    struct trampoline<Return (*)(environment&, Self, Args...), F> {
+        using result_type = typename marshal<std::decay_t<Return>>::jni_type;
+        static result_type JNICALL call(JNIEnv* e, Self self,
+                typename marshal<std::decay_t<Args>>::jni_type... a) noexcept {
+            return native_entry(e, [&]{
+                environment env{ e };
+                return detail::native_return<std::decay_t<Return>>::call(e, [&]() -> Return {
+                    return F(env, self, marshal<std::decay_t<Args>>::from_jni(e, a)...);
+                });
+            });
+        }
+    };
+#define JNIPP_NATIVE_METHOD(name, function) \
+    ::jnipp::native_method(name, &::jnipp::trampoline<decltype(&function), &function>::call)
 }
 #endif // JNIPP_JNIPP_HPP
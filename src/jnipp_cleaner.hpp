@@ -0,0 +1,207 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_cleaner.hpp
+//! \brief   JNI++ deferred, batched destruction of native peers
+//!
+//! Ties a peer's lifetime to a Java object through a java.lang.ref.Cleaner
+//! action, without running its destructor on the JVM's cleaner thread: the
+//! native behind the action only queues the peer, and a reaper thread
+//! destroys the queue in batches.
+//!
+//!   // Java
+//!   final class Session implements AutoCloseable {
+//!       private static final Cleaner CLEANER = Cleaner.create();
+//!       private final long handle = open();
+//!       private final Cleaner.Cleanable cleanable = CLEANER.register(this, new Release(handle));
+//!       public void close(){ cleanable.clean(); }
+//!       private static final class Release implements Runnable {
+//!           private final long handle;
+//!           Release(long handle){ this.handle = handle; }
+//!           public void run(){ release(handle); }
+//!       }
+//!       private static native long open();
+//!       private static native void release(long handle);
+//!   }
+//!
+//!   // C++
+//!   static jnipp::handles::registry<session> sessions;
+//!   auto reaper = jnipp::cleaner::reaper::start(vm);
+//!   jnipp::cleaner::attach(sessions, *reaper);
+//!   static JNINativeMethod const methods[] = {
+//!       jnipp::native_method("release", &jnipp::cleaner::release<session>),
+//!   };
+//!
+//! The reaper thread is attached, so destructors may use JNI through
+//! JavaVM::GetEnv, e.g. to delete global references.
+//=============================================================================
+#ifndef JNIPP_JNIPP_CLEANER_HPP
+#define JNIPP_JNIPP_CLEANER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "jnipp.hpp"
+#include "jnipp_handles.hpp"
+
+namespace jnipp {
+    namespace cleaner {
+        class reaper {
+        private:
+            struct item {
+                void* peer;
+                void (*destroy)(void*);
+            };
+            template<typename T>
+            static void destroy(void* p){
+                delete static_cast<T*>(p);
+            }
+
+            JavaVM* vm;
+            std::size_t batch;
+            std::chrono::milliseconds interval;
+            std::mutex lock;
+            std::condition_variable wake;
+            std::vector<item> queue;
+            bool stopping = false;
+            std::atomic<std::uint64_t> destroyed_peers{ 0 };
+            std::atomic<std::uint64_t> batches{ 0 };
+            std::thread thread;
+
+            reaper(JavaVM* vm, std::size_t batch, std::chrono::milliseconds interval)
+                : vm{ vm }, batch{ batch }, interval{ interval } {}
+
+            // Waits for a first peer, then up to interval for a full batch,
+            // so a steady trickle costs one wakeup per interval.
+            void run(){
+                std::vector<item> work;
+                for(;;){
+                    {
+                        std::unique_lock<std::mutex> guard{ lock };
+                        wake.wait(guard, [this]{ return stopping || !queue.empty(); });
+                        wake.wait_for(guard, interval, [this]{ return stopping || queue.size() >= batch; });
+                        if(queue.empty()) return;
+                        work.swap(queue);
+                    }
+                    for(auto& i : work){
+                        i.destroy(i.peer);
+                    }
+                    destroyed_peers.fetch_add(work.size(), std::memory_order_relaxed);
+                    batches.fetch_add(1, std::memory_order_relaxed);
+                    work.clear();
+                }
+            }
+
+        public:
+            // Returns null if the thread cannot be attached.
+            static std::unique_ptr<reaper> start(JavaVM* vm, std::size_t batch = 256,
+                    std::chrono::milliseconds interval = std::chrono::milliseconds{ 10 }){
+                std::unique_ptr<reaper> r{ new reaper{ vm, batch, interval } };
+                std::promise<bool> attached;
+                auto ok = attached.get_future();
+                // The promise moves into the thread: set_value may still be
+                // running when start() returns.
+                r->thread = std::thread{ [p = r.get(), attached = std::move(attached)]() mutable {
+                    JNIEnv* e = nullptr;
+                    if(p->vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&e), nullptr) != JNI_OK){
+                        attached.set_value(false);
+                        return;
+                    }
+                    attached.set_value(true);
+                    p->run();
+                    p->vm->DetachCurrentThread();
+                } };
+                if(!ok.get()){
+                    r->thread.join();
+                    return nullptr;
+                }
+                return r;
+            }
+            reaper(reaper const&) = delete;
+            reaper& operator=(reaper const&) = delete;
+            // Destroys everything queued before returning.
+            ~reaper(){
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    stopping = true;
+                }
+                wake.notify_one();
+                if(thread.joinable()) thread.join();
+                for(auto& i : queue){
+                    i.destroy(i.peer);
+                }
+            }
+
+            // Any thread. Queues p for destruction on the reaper thread; if
+            // the queue cannot grow, p is destroyed here instead.
+            template<typename T>
+            void retire(std::unique_ptr<T> p) noexcept {
+                if(!p) return;
+                std::size_t n;
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    try{
+                        queue.push_back(item{ p.get(), &destroy<T> });
+                    }catch(std::bad_alloc const&){
+                        return;
+                    }
+                    p.release();
+                    n = queue.size();
+                }
+                if(n == 1 || n == batch) wake.notify_one();
+            }
+
+            std::uint64_t destroyed() const noexcept {
+                return destroyed_peers.load(std::memory_order_relaxed);
+            }
+            std::uint64_t batch_count() const noexcept {
+                return batches.load(std::memory_order_relaxed);
+            }
+        };
+
+        // The registry and reaper behind release<T>, one pair per peer type.
+        template<typename T>
+        struct binding {
+            static std::atomic<handles::registry<T>*> peers;
+            static std::atomic<reaper*> target;
+        };
+        template<typename T>
+        std::atomic<handles::registry<T>*> binding<T>::peers{ nullptr };
+        template<typename T>
+        std::atomic<reaper*> binding<T>::target{ nullptr };
+
+        // Call before registering release<T>; both must outlive its calls.
+        template<typename T>
+        void attach(handles::registry<T>& peers, reaper& r) noexcept {
+            binding<T>::peers.store(&peers, std::memory_order_release);
+            binding<T>::target.store(&r, std::memory_order_release);
+        }
+
+        // Native for `static native void release(long handle)`: unregisters
+        // the peer and queues it on the reaper. A stale handle is ignored,
+        // so close() followed by the Cleaner is harmless.
+        template<typename T>
+        void JNICALL release(JNIEnv*, jclass, jlong handle){
+            auto peers = binding<T>::peers.load(std::memory_order_acquire);
+            auto r = binding<T>::target.load(std::memory_order_acquire);
+            if(peers == nullptr || r == nullptr) return;
+            r->retire(peers->release(handle));
+        }
+    }
+}
+#endif // JNIPP_JNIPP_CLEANER_HPP
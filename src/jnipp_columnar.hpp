@@ -0,0 +1,478 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_columnar.hpp
+//! \brief   JNI++ columnar record batches in native memory
+//!
+//! A schema names the columns of a table; a batch stores its rows column by
+//! column, and Java reads them through direct ByteBuffers without a copy:
+//!
+//!   using trades = jnipp::columnar::schema<
+//!       jnipp::columnar::column<std::int64_t, 't','i','m','e'>,
+//!       jnipp::columnar::column<double, 'p','r','i','c','e'>,
+//!       jnipp::columnar::column<std::string, 's','y','m','b','o','l'>>;
+//!   jnipp::columnar::batch<trades> b;
+//!   b.append(t, 101.5, "ACME");
+//!   b.append(t, jnipp::columnar::null, "ACME");
+//!   // Java: void onTrades(int rows, ByteBuffer[] buffers)
+//!   on_trades(sink, static_cast<jint>(b.size()), *b.to_java(env));
+//!
+//! Every column starts with a validity bitmap, bit i (LSB first) set when
+//! row i is not null. Arithmetic columns then hold one value per row at its
+//! C++ width, bool as one byte; unsigned types are read through the signed
+//! Java type of that width, except std::uint16_t, which is a char. Other
+//! arithmetic types, e.g. long double, do not compile. std::string columns
+//! hold rows + 1 int32 offsets followed by their UTF-8 data. Buffers are in native byte order,
+//! so Java reads them with buf.order(ByteOrder.nativeOrder()).
+//! trades::java_source() writes the matching buffer indices as a Java
+//! class, and trades::from_java() views a batch Java filled the same way.
+//!
+//! The buffers point into the batch: it must outlive them and must not be
+//! appended to while Java holds them.
+//=============================================================================
+#ifndef JNIPP_JNIPP_COLUMNAR_HPP
+#define JNIPP_JNIPP_COLUMNAR_HPP
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace columnar {
+        struct null_t {};
+        constexpr null_t null{};
+
+        namespace detail {
+            inline bool valid(std::uint8_t const* bitmap, std::size_t i) noexcept {
+                return ((bitmap[i >> 3] >> (i & 7)) & 1) != 0;
+            }
+            inline std::size_t bitmap_bytes(std::size_t rows) noexcept {
+                return (rows + 7) / 8;
+            }
+            // Starts a new bitmap byte every eighth row.
+            inline void push_bit(std::vector<std::uint8_t>& bitmap, std::size_t row, bool set){
+                if((row & 7) == 0) bitmap.push_back(0);
+                if(set) bitmap.back() |= static_cast<std::uint8_t>(1u << (row & 7));
+            }
+            constexpr std::size_t sum(std::initializer_list<std::size_t> counts) noexcept {
+                std::size_t n = 0;
+                for(auto c : counts) n += c;
+                return n;
+            }
+            // A buffer as NewDirectByteBuffer takes it, or as Java handed it.
+            struct region {
+                void* address;
+                std::size_t bytes;
+            };
+        }
+
+        // Non-owning view of a fixed-width column.
+        template<typename T>
+        class fixed_view {
+        private:
+            std::uint8_t const* validity = nullptr;
+            T const* values = nullptr;
+            std::size_t rows = 0;
+        public:
+            fixed_view() noexcept = default;
+            fixed_view(std::uint8_t const* validity, T const* values, std::size_t rows) noexcept
+                : validity{ validity }, values{ values }, rows{ rows } {}
+            std::size_t size() const noexcept {
+                return rows;
+            }
+            bool valid(std::size_t i) const noexcept {
+                return detail::valid(validity, i);
+            }
+            // Null rows read as zero in batches built here.
+            T operator[](std::size_t i) const noexcept {
+                return values[i];
+            }
+            T const* data() const noexcept {
+                return values;
+            }
+        };
+
+        struct text {
+            char const* data;
+            std::size_t size;
+            std::string str() const {
+                return std::string(data, size);
+            }
+        };
+        // Non-owning view of a UTF-8 column.
+        class utf8_view {
+        private:
+            std::uint8_t const* validity = nullptr;
+            std::int32_t const* offsets = nullptr;
+            char const* bytes = nullptr;
+            std::size_t rows = 0;
+        public:
+            utf8_view() noexcept = default;
+            utf8_view(std::uint8_t const* validity, std::int32_t const* offsets, char const* bytes, std::size_t rows) noexcept
+                : validity{ validity }, offsets{ offsets }, bytes{ bytes }, rows{ rows } {}
+            std::size_t size() const noexcept {
+                return rows;
+            }
+            bool valid(std::size_t i) const noexcept {
+                return detail::valid(validity, i);
+            }
+            // Null rows read as empty.
+            text operator[](std::size_t i) const noexcept {
+                return text{ bytes + offsets[i], static_cast<std::size_t>(offsets[i + 1] - offsets[i]) };
+            }
+        };
+
+        template<typename T, char... Name>
+        struct column {
+            static_assert(!std::is_void<typename jnipp::element<T>::type>::value,
+                "columnar::column types must be bool, char, std::int8_t to std::int64_t, std::uint8_t to std::uint64_t, "
+                "float, double or std::string.");
+            using name = pack<Name...>;
+            // std::vector<bool> has no data(), so bools are stored as jboolean.
+            using type = typename std::conditional<std::is_same<T, bool>::value, jboolean, T>::type;
+            using signature = mangle<typename jnipp::element<T>::type>;
+            static_assert(sizeof(type) == sizeof(typename jnipp::element<T>::type), "Column width must match Java.");
+            using view = fixed_view<type>;
+            static constexpr std::size_t buffers = 2;
+
+            class storage {
+            private:
+                std::vector<std::uint8_t> validity;
+                std::vector<type> values;
+            public:
+                // Reserving at least one element keeps every buffer address
+                // non-null, even for an empty batch.
+                void reserve(std::size_t rows){
+                    validity.reserve(detail::bitmap_bytes(rows) + 1);
+                    values.reserve(rows + 1);
+                }
+                void clear() noexcept {
+                    validity.clear();
+                    values.clear();
+                }
+                void push(std::size_t row, T v){
+                    detail::push_bit(validity, row, true);
+                    values.push_back(static_cast<type>(v));
+                }
+                void push(std::size_t row, null_t){
+                    detail::push_bit(validity, row, false);
+                    values.push_back(type{});
+                }
+                view get(std::size_t rows) const noexcept {
+                    return view{ validity.data(), values.data(), rows };
+                }
+                detail::region* regions(detail::region* out) const noexcept {
+                    *out++ = detail::region{ const_cast<std::uint8_t*>(validity.data()), validity.size() };
+                    *out++ = detail::region{ const_cast<type*>(values.data()), values.size() * sizeof(type) };
+                    return out;
+                }
+                std::size_t capacity_bytes() const noexcept {
+                    return validity.capacity() + values.capacity() * sizeof(type);
+                }
+            };
+
+            static bool adopt(detail::region const* in, std::size_t rows, view& out) noexcept {
+                if(in[0].bytes < detail::bitmap_bytes(rows) || in[1].bytes / sizeof(type) < rows) return false;
+                out = view{ static_cast<std::uint8_t const*>(in[0].address), static_cast<type const*>(in[1].address), rows };
+                return true;
+            }
+        };
+
+        template<char... Name>
+        struct column<std::string, Name...> {
+            using name = pack<Name...>;
+            using signature = mangle<jnipp::jstring>;
+            using view = utf8_view;
+            static constexpr std::size_t buffers = 3;
+
+            class storage {
+            private:
+                std::vector<std::uint8_t> validity;
+                std::vector<std::int32_t> offsets{ 0 };
+                std::vector<char> bytes;
+            public:
+                void reserve(std::size_t rows){
+                    validity.reserve(detail::bitmap_bytes(rows) + 1);
+                    offsets.reserve(rows + 1);
+                    bytes.reserve(rows * 8 + 1);
+                }
+                void clear() noexcept {
+                    validity.clear();
+                    offsets.resize(1);
+                    bytes.clear();
+                }
+                void push(std::size_t row, char const* s, std::size_t n){
+                    detail::push_bit(validity, row, true);
+                    bytes.insert(bytes.end(), s, s + n);
+                    offsets.push_back(static_cast<std::int32_t>(bytes.size()));
+                }
+                void push(std::size_t row, std::string const& s){
+                    push(row, s.data(), s.size());
+                }
+                void push(std::size_t row, char const* s){
+                    push(row, s, std::strlen(s));
+                }
+                void push(std::size_t row, text s){
+                    push(row, s.data, s.size);
+                }
+                void push(std::size_t row, null_t){
+                    detail::push_bit(validity, row, false);
+                    offsets.push_back(offsets.back());
+                }
+                view get(std::size_t rows) const noexcept {
+                    return view{ validity.data(), offsets.data(), bytes.data(), rows };
+                }
+                detail::region* regions(detail::region* out) const noexcept {
+                    *out++ = detail::region{ const_cast<std::uint8_t*>(validity.data()), validity.size() };
+                    *out++ = detail::region{ const_cast<std::int32_t*>(offsets.data()), offsets.size() * sizeof(std::int32_t) };
+                    *out++ = detail::region{ const_cast<char*>(bytes.data()), bytes.size() };
+                    return out;
+                }
+                std::size_t capacity_bytes() const noexcept {
+                    return validity.capacity() + offsets.capacity() * sizeof(std::int32_t) + bytes.capacity();
+                }
+            };
+
+            // Offsets from Java are checked to be ascending and in bounds,
+            // so a view never reads outside the buffers.
+            static bool adopt(detail::region const* in, std::size_t rows, view& out) noexcept {
+                if(in[0].bytes < detail::bitmap_bytes(rows) || in[1].bytes / sizeof(std::int32_t) < rows + 1) return false;
+                auto offsets = static_cast<std::int32_t const*>(in[1].address);
+                if(offsets[0] < 0) return false;
+                for(std::size_t i = 0; i < rows; ++i){
+                    if(offsets[i + 1] < offsets[i]) return false;
+                }
+                if(static_cast<std::size_t>(offsets[rows]) > in[2].bytes) return false;
+                out = view{ static_cast<std::uint8_t const*>(in[0].address), offsets, static_cast<char const*>(in[2].address), rows };
+                return true;
+            }
+        };
+
+        template<typename... Columns>
+        struct schema {
+            using views = std::tuple<typename Columns::view...>;
+            static constexpr std::size_t columns = sizeof...(Columns);
+            static constexpr std::size_t buffers = detail::sum({ Columns::buffers... });
+
+            // Index of the first buffer (the validity bitmap) of column I.
+            static constexpr std::size_t first_buffer(std::size_t column) noexcept {
+                std::size_t const counts[] = { Columns::buffers... };
+                std::size_t n = 0;
+                for(std::size_t i = 0; i < column; ++i) n += counts[i];
+                return n;
+            }
+
+            // Views over rows Java filled in buffers laid out like a batch.
+            static jni_expected<views> from_java(JNIEnv* env, jint rows, jobjectArray array){
+                if(rows < 0 || array == NULL || env->GetArrayLength(array) != static_cast<jsize>(buffers)){
+                    return jni_raise(env, "Wrong buffer count in columnar::schema::from_java function.");
+                }
+                detail::region in[buffers];
+                for(std::size_t i = 0; i < buffers; ++i){
+                    jobject b = env->GetObjectArrayElement(array, static_cast<jsize>(i));
+                    in[i].address = b == NULL ? nullptr : env->GetDirectBufferAddress(b);
+                    jlong capacity = b == NULL ? -1 : env->GetDirectBufferCapacity(b);
+                    in[i].bytes = capacity < 0 ? 0 : static_cast<std::size_t>(capacity);
+                    env->DeleteLocalRef(b);
+                    if(in[i].address == nullptr){
+                        return jni_raise(env, "Not a direct buffer in columnar::schema::from_java function.");
+                    }
+                }
+                views v;
+                if(!adopt(in, static_cast<std::size_t>(rows), v, std::index_sequence_for<Columns...>{})){
+                    return jni_raise(env, "Buffer too small in columnar::schema::from_java function.");
+                }
+                return v;
+            }
+
+            // Source of a Java class holding the layout: the column names
+            // and JNI type signatures, and the first buffer of each column.
+            static std::string java_source(char const* package, char const* name){
+                std::string s;
+                if(package != NULL && *package != '\0'){
+                    s += "package "; s += package; s += ";\n\n";
+                }
+                s += "// Generated from the C++ schema by jnipp::columnar; do not edit.\n";
+                s += "public final class "; s += name; s += " {\n";
+                s += "    private "; s += name; s += "(){}\n\n";
+                s += "    public static final int COLUMNS = " + std::to_string(columns) + ";\n";
+                s += "    public static final int BUFFERS = " + std::to_string(buffers) + ";\n";
+                s += "    public static final String[] NAMES = {";
+                (void)std::initializer_list<int>{ (s += std::string(" \"") + Columns::name::str + "\",", 0)... };
+                s.back() = ' ';
+                s += "};\n";
+                s += "    public static final String[] TYPES = {";
+                (void)std::initializer_list<int>{ (s += std::string(" \"") + Columns::signature::str + "\",", 0)... };
+                s.back() = ' ';
+                s += "};\n\n";
+                s += "    // Validity bitmap of each column; values, or offsets then data, follow.\n";
+                std::size_t i = 0;
+                (void)std::initializer_list<int>{ (s += "    public static final int " +
+                    constant(Columns::name::str) + " = " + std::to_string(first_buffer(i++)) + ";\n", 0)... };
+                s += "}\n";
+                return s;
+            }
+
+        private:
+            template<std::size_t... I>
+            static bool adopt(detail::region const* in, std::size_t rows, views& v, std::index_sequence<I...>) noexcept {
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok &&
+                    Columns::adopt(in + first_buffer(I), rows, std::get<I>(v)), 0)... };
+                return ok;
+            }
+            // bidPrice -> BID_PRICE
+            static std::string constant(char const* name){
+                std::string s;
+                for(char const* p = name; *p != '\0'; ++p){
+                    auto c = static_cast<unsigned char>(*p);
+                    if(std::isupper(c) && p != name && std::islower(static_cast<unsigned char>(p[-1]))) s += '_';
+                    s += static_cast<char>(std::toupper(c));
+                }
+                return s;
+            }
+        };
+
+        template<typename Schema>
+        class batch;
+        template<typename... Columns>
+        class batch<schema<Columns...>> {
+        public:
+            using schema_type = schema<Columns...>;
+
+        private:
+            using indices = std::index_sequence_for<Columns...>;
+            std::tuple<typename Columns::storage...> columns;
+            std::size_t rows = 0;
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+            // Bytes last reported; growth between to_java() calls is only
+            // counted at the next one.
+            mutable std::size_t accounted = 0;
+
+            template<std::size_t... I>
+            std::size_t capacity_bytes(std::index_sequence<I...>) const noexcept {
+                std::size_t n = 0;
+                (void)std::initializer_list<int>{ (n += std::get<I>(columns).capacity_bytes(), 0)... };
+                return n;
+            }
+            void account() const noexcept {
+                auto now = capacity_bytes(indices{});
+                if(now > accounted) memory::acquire(memory::columnar, now - accounted);
+                else memory::release(memory::columnar, accounted - now);
+                accounted = now;
+            }
+#endif
+
+            template<std::size_t... I>
+            void reserve(std::size_t n, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (std::get<I>(columns).reserve(n), 0)... };
+            }
+            template<std::size_t... I, typename... Values>
+            void push(std::index_sequence<I...>, Values const&... values){
+                (void)std::initializer_list<int>{ (std::get<I>(columns).push(rows, values), 0)... };
+            }
+            template<std::size_t... I>
+            void clear(std::index_sequence<I...>) noexcept {
+                (void)std::initializer_list<int>{ (std::get<I>(columns).clear(), 0)... };
+            }
+            template<std::size_t... I>
+            typename schema_type::views views(std::index_sequence<I...>) const noexcept {
+                return typename schema_type::views{ std::get<I>(columns).get(rows)... };
+            }
+            template<std::size_t... I>
+            void regions(detail::region* out, std::index_sequence<I...>) const noexcept {
+                (void)std::initializer_list<int>{ (out = std::get<I>(columns).regions(out), 0)... };
+            }
+
+        public:
+            explicit batch(std::size_t capacity = 1024){
+                reserve(capacity, indices{});
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                account();
+#endif
+            }
+            batch(batch const&) = delete;
+            batch& operator=(batch const&) = delete;
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+            ~batch(){
+                memory::release(memory::columnar, accounted);
+            }
+#endif
+
+            // One value per column, or null; std::string columns also take
+            // char const* and text.
+            template<typename... Values>
+            void append(Values const&... values){
+                static_assert(sizeof...(Values) == sizeof...(Columns), "One value per column.");
+                push(indices{}, values...);
+                ++rows;
+            }
+            // Keeps the memory for the next batch.
+            void clear() noexcept {
+                clear(indices{});
+                rows = 0;
+            }
+            std::size_t size() const noexcept {
+                return rows;
+            }
+
+            template<std::size_t I>
+            typename std::tuple_element<I, typename schema_type::views>::type column() const noexcept {
+                return std::get<I>(columns).get(rows);
+            }
+            typename schema_type::views views() const noexcept {
+                return views(indices{});
+            }
+
+            // Local reference to a ByteBuffer[] of schema_type::buffers
+            // direct buffers, in column order.
+            jni_expected<jobjectArray> to_java(JNIEnv* env) const {
+                detail::region out[schema_type::buffers];
+                regions(out, indices{});
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                account();
+#endif
+                for(auto const& r : out){
+                    if(r.bytes > static_cast<std::size_t>(std::numeric_limits<jint>::max())){
+                        return jni_raise(env, "Column too large in columnar::batch::to_java function.");
+                    }
+                }
+                jclass c = env->FindClass("java/nio/ByteBuffer");
+                if(c == NULL){
+                    return jni_raise(env, "Class not found in columnar::batch::to_java function.");
+                }
+                jobjectArray a = env->NewObjectArray(static_cast<jsize>(schema_type::buffers), c, NULL);
+                env->DeleteLocalRef(c);
+                if(a == NULL){
+                    return jni_raise(env, "Array allocation failed in columnar::batch::to_java function.");
+                }
+                for(std::size_t i = 0; i < schema_type::buffers; ++i){
+                    jobject b = env->NewDirectByteBuffer(out[i].address, static_cast<jlong>(out[i].bytes));
+                    if(b == NULL){
+                        env->DeleteLocalRef(a);
+                        return jni_raise(env, "NewDirectByteBuffer failed in columnar::batch::to_java function.");
+                    }
+                    env->SetObjectArrayElement(a, static_cast<jsize>(i), b);
+                    env->DeleteLocalRef(b);
+                }
+                return a;
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_COLUMNAR_HPP
@@ -0,0 +1,269 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_coro.hpp
+//! \brief   JNI++ co_await-able Java calls on a JVM worker thread
+//!
+//! Requires C++20; include it instead of jnipp.hpp where coroutines are
+//! used. A worker is a thread attached to the JVM for its whole lifetime.
+//! Coroutines running anywhere, attached or not, hand it method calls:
+//!
+//!   auto w = jnipp::coro::worker::start(vm, [&loop](auto h){ loop.post(h); });
+//!   ...
+//!   jnipp::coro::expected<jint> r = co_await jnipp::coro::invoke(*w, size, list);
+//!
+//! Object arguments must be global references, since the call runs on the
+//! worker's JNIEnv. Object results are returned as new global references
+//! owned by the caller. A Java exception is described and cleared on the
+//! worker and surfaces as a coro::error, which keeps the description and
+//! a global reference to the throwable that its last copy deletes.
+//!
+//! Results are coro::expected rather than jni_expected: a jni_error reads
+//! the exception pending on its JNIEnv, which belongs to the worker and is
+//! cleared before the coroutine resumes, possibly on another thread.
+//=============================================================================
+#ifndef JNIPP_JNIPP_CORO_HPP
+#define JNIPP_JNIPP_CORO_HPP
+
+#if __cplusplus < 202002L
+#error "jnipp_coro.hpp requires C++20."
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "jnipp.hpp"
+
+#ifndef JNIPP_CORO_LOCAL_FRAME
+// Local references a single call may create on the worker.
+#define JNIPP_CORO_LOCAL_FRAME 16
+#endif
+
+namespace jnipp {
+    namespace coro {
+        // A failed call. The awaiting coroutine has no JNIEnv of the worker,
+        // so a Java exception is captured there before it is cleared.
+        class error {
+        private:
+            // Deletes the global reference from whichever thread drops the
+            // last copy, attaching it for the call if needed.
+            struct global_deleter {
+                JavaVM* vm;
+                void operator()(jthrowable t) const noexcept {
+                    if(t == NULL || vm == nullptr) return;
+                    JNIEnv* env = nullptr;
+                    if(vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK){
+                        env->DeleteGlobalRef(t);
+                    }
+                    else if(vm->AttachCurrentThread(reinterpret_cast<void**>(&env), nullptr) == JNI_OK){
+                        env->DeleteGlobalRef(t);
+                        vm->DetachCurrentThread();
+                    }
+                }
+            };
+
+            std::string text;
+            std::shared_ptr<std::remove_pointer_t<jthrowable>> throwable;
+        public:
+            explicit error(std::string description)
+                : text{ std::move(description) } {}
+            // Takes over global, a global reference, or NULL.
+            error(std::string description, JavaVM* vm, jthrowable global)
+                : text{ std::move(description) }, throwable{ global, global_deleter{ vm } } {}
+            char const* get_message() const noexcept {
+                return text.c_str();
+            }
+            // Message followed by the Java stack trace, as jni_error::describe().
+            std::string const& describe() const noexcept {
+                return text;
+            }
+            bool has_exception() const noexcept {
+                return throwable != nullptr;
+            }
+            // Global reference to the throwable, or NULL. It lives as long
+            // as some copy of the error does; NewGlobalRef it to keep it
+            // longer.
+            jthrowable get_exception() const noexcept {
+                return throwable.get();
+            }
+        };
+        template<typename T>
+        using expected = ornew::expected<T, error>;
+
+        class worker {
+        public:
+            // Decides where an awaiting coroutine continues. Without one it
+            // resumes on the worker thread, which then runs the coroutine
+            // until its next suspension.
+            using resumer = std::function<void(std::coroutine_handle<>)>;
+            using job = std::function<void(JNIEnv*)>;
+
+        private:
+            JavaVM* vm;
+            resumer resume;
+            std::mutex lock;
+            std::condition_variable wake;
+            std::deque<job> jobs;
+            bool stopping = false;
+            std::thread thread;
+
+            worker(JavaVM* vm, resumer r)
+                : vm{ vm }, resume{ std::move(r) } {}
+            void run(JNIEnv* env){
+                for(;;){
+                    job j;
+                    {
+                        std::unique_lock<std::mutex> guard{ lock };
+                        wake.wait(guard, [this]{ return stopping || !jobs.empty(); });
+                        if(jobs.empty()) return;
+                        j = std::move(jobs.front());
+                        jobs.pop_front();
+                    }
+                    j(env);
+                }
+            }
+
+        public:
+            // Returns null if the thread cannot be attached.
+            static std::unique_ptr<worker> start(JavaVM* vm, resumer r = {}){
+                std::unique_ptr<worker> w{ new worker{ vm, std::move(r) } };
+                std::promise<JNIEnv*> attached;
+                auto env = attached.get_future();
+                // The promise moves into the thread: set_value may still be
+                // running when start() returns.
+                w->thread = std::thread{ [p = w.get(), attached = std::move(attached)]() mutable {
+                    JNIEnv* e = nullptr;
+                    if(p->vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&e), nullptr) != JNI_OK){
+                        attached.set_value(nullptr);
+                        return;
+                    }
+                    attached.set_value(e);
+                    p->run(e);
+                    p->vm->DetachCurrentThread();
+                } };
+                if(env.get() == nullptr){
+                    w->thread.join();
+                    return nullptr;
+                }
+                return w;
+            }
+            worker(worker const&) = delete;
+            worker& operator=(worker const&) = delete;
+            // Finishes the queued jobs, so no awaiting coroutine is lost.
+            ~worker(){
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    stopping = true;
+                }
+                wake.notify_one();
+                if(thread.joinable()) thread.join();
+            }
+
+            void post(job j){
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    jobs.push_back(std::move(j));
+                }
+                wake.notify_one();
+            }
+            void resume_awaiter(std::coroutine_handle<> h){
+                if(resume) resume(h);
+                else h.resume();
+            }
+        };
+
+        // Awaiter of one method call; the result lives in the coroutine
+        // frame until await_resume().
+        template<typename T, typename Policy, typename... Args>
+        class call {
+            static_assert(!std::is_same_v<Policy, check::deferred>, "coro calls have no exception_scope; use none or immediate.");
+        private:
+            worker& w;
+            method<T, Policy> m;
+            jobject obj;
+            std::tuple<Args...> args;
+            std::optional<expected<T>> result;
+
+            // Describes the pending exception and keeps the throwable, then
+            // clears it on the worker.
+            static auto raised(JNIEnv* env){
+                auto text = jni_error{ env, exception_pending, "Java exception thrown on jnipp::coro::worker." }.describe();
+                jthrowable t = env->ExceptionOccurred();
+                env->ExceptionClear();
+                auto global = static_cast<jthrowable>(env->NewGlobalRef(t));
+                env->DeleteLocalRef(t);
+                JavaVM* vm = nullptr;
+                env->GetJavaVM(&vm);
+                return ornew::raise<error>(std::move(text), vm, global);
+            }
+            void run(JNIEnv* env){
+                if(env->PushLocalFrame(JNIPP_CORO_LOCAL_FRAME) != JNI_OK){
+                    result.emplace(raised(env));
+                    return;
+                }
+                m.rebind(env);
+                if constexpr(std::is_void_v<T>){
+                    std::apply([this](auto&... a){ m(obj, a...); }, args);
+                    if(env->ExceptionCheck() == JNI_TRUE){
+                        result.emplace(raised(env));
+                    }
+                    else{
+                        result.emplace();
+                    }
+                }
+                else{
+                    auto r = std::apply([this](auto&... a){ return m(obj, a...); }, args);
+                    if(env->ExceptionCheck() == JNI_TRUE){
+                        result.emplace(raised(env));
+                    }
+                    else{
+                        T value;
+                        if constexpr(std::is_same_v<Policy, check::immediate>) value = *r;
+                        else value = r;
+                        if constexpr(std::is_convertible_v<T, jobject>) value = static_cast<T>(env->NewGlobalRef(value));
+                        result.emplace(value);
+                    }
+                }
+                env->PopLocalFrame(NULL);
+            }
+
+        public:
+            call(worker& w, method<T, Policy> m, jobject obj, Args... a)
+                : w{ w }, m{ m }, obj{ obj }, args{ std::move(a)... } {}
+            bool await_ready() const noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> h){
+                w.post([this, h](JNIEnv* env){
+                    run(env);
+                    w.resume_awaiter(h);
+                });
+            }
+            expected<T> await_resume(){
+                return std::move(*result);
+            }
+        };
+
+        template<typename T, typename Policy, typename... Args>
+        auto invoke(worker& w, method<T, Policy> m, jobject obj, Args&&... a){
+            return call<T, Policy, std::decay_t<Args>...>{ w, m, obj, std::forward<Args>(a)... };
+        }
+    }
+}
+#endif // JNIPP_JNIPP_CORO_HPP
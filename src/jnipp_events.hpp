@@ -0,0 +1,292 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_events.hpp
+//! \brief   JNI++ batched delivery of native events to a Java listener
+//!
+//! Native threads push events into a lock-free queue without touching JNI.
+//! One attached drainer thread packs whatever is queued into one primitive
+//! array per event member and calls the listener once per batch:
+//!
+//!   struct tick { std::int64_t time; double price; };
+//!   using ticks = jnipp::events::pump<tick, 1 << 16,
+//!       JNIPP_SOA_FIELD(tick, time), JNIPP_SOA_FIELD(tick, price)>;
+//!   // Java: void onTicks(int count, long[] time, double[] price)
+//!   auto on_ticks = *listener_class.get_method<ticks::signature>("onTicks");
+//!   auto p = ticks::start(vm, global_listener, on_ticks);
+//!   p->push(tick{ t, 101.5 });  // any thread
+//!
+//! The arrays are reused for every batch; the listener must copy what it
+//! keeps before returning. Only the first count elements are valid. An
+//! idle drainer parks on a condition variable; a push wakes it only while
+//! it is parked, so a busy pump takes no lock.
+//=============================================================================
+#ifndef JNIPP_JNIPP_EVENTS_HPP
+#define JNIPP_JNIPP_EVENTS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "jnipp.hpp"
+#include "jnipp_soa.hpp"
+
+namespace jnipp {
+    namespace events {
+        // Bounded multi-producer single-consumer queue. Each cell carries a
+        // sequence number telling producers and the consumer whose turn it
+        // is, so neither side takes a lock.
+        template<typename Event, std::size_t Capacity>
+        class queue {
+            static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+            static_assert(std::is_trivially_copyable<Event>::value, "Events must be trivially copyable.");
+        private:
+            struct cell {
+                std::atomic<std::size_t> sequence;
+                Event event;
+            };
+            // Padding rather than alignas keeps the queue allocatable with
+            // plain operator new before C++17.
+            std::unique_ptr<cell[]> cells;
+            char pad0[64];
+            std::atomic<std::size_t> head{ 0 };
+            char pad1[64];
+            std::size_t tail = 0;
+            char pad2[64];
+            std::atomic<std::uint64_t> dropped_events{ 0 };
+        public:
+            queue()
+                : cells{ new cell[Capacity] } {
+                for(std::size_t i = 0; i < Capacity; ++i){
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+            queue(queue const&) = delete;
+            queue& operator=(queue const&) = delete;
+
+            // Any thread. Returns false and counts the event as dropped if
+            // the queue is full.
+            bool push(Event const& e) noexcept {
+                auto pos = head.load(std::memory_order_relaxed);
+                for(;;){
+                    auto& c = cells[pos & (Capacity - 1)];
+                    auto seq = c.sequence.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if(diff == 0){
+                        if(head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                            c.event = e;
+                            // seq_cst, with ready(): see pump::parked.
+                            c.sequence.store(pos + 1, std::memory_order_seq_cst);
+                            return true;
+                        }
+                    }
+                    else if(diff < 0){
+                        dropped_events.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    else{
+                        pos = head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+            // Consumer thread only.
+            bool ready() const noexcept {
+                return cells[tail & (Capacity - 1)].sequence.load(std::memory_order_seq_cst) == tail + 1;
+            }
+            bool pop(Event& e) noexcept {
+                auto& c = cells[tail & (Capacity - 1)];
+                if(c.sequence.load(std::memory_order_acquire) != tail + 1) return false;
+                e = c.event;
+                c.sequence.store(tail + Capacity, std::memory_order_release);
+                ++tail;
+                return true;
+            }
+            std::uint64_t dropped() const noexcept {
+                return dropped_events.load(std::memory_order_relaxed);
+            }
+        };
+
+        template<typename Event, std::size_t Capacity, typename... Fields>
+        class pump {
+        public:
+            // Pass to clas::get_method to resolve the listener:
+            // void(int count, T1[] column1, T2[] column2, ...).
+            using signature = void(jint, typename Fields::array...);
+
+        private:
+            using arrays = std::tuple<typename Fields::array...>;
+            using staging = std::tuple<std::vector<typename Fields::type>...>;
+            using indices = std::index_sequence_for<Fields...>;
+
+            queue<Event, Capacity> events;
+            JavaVM* vm;
+            jobject listener;
+            method<void> on_batch;
+            std::size_t batch;
+            std::atomic<bool> stopping{ false };
+            // The drainer sets parked before its last look at the queue, and
+            // producers read it after publishing an event. Both sides use
+            // seq_cst operations, so at least one of them sees the other.
+            std::atomic<bool> parked{ false };
+            std::mutex lock;
+            std::condition_variable wake;
+            std::atomic<std::uint64_t> delivered_batches{ 0 };
+            std::atomic<std::uint64_t> failed_batches{ 0 };
+            std::thread thread;
+
+            pump(JavaVM* vm, jobject listener, method<void> on_batch, std::size_t batch)
+                : vm{ vm }, listener{ listener }, on_batch{ on_batch }, batch{ batch } {}
+
+            // Stops at the first failure: no JNI call may follow a pending
+            // OutOfMemoryError.
+            template<std::size_t... I>
+            bool allocate(JNIEnv* env, arrays& a, staging& s, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (std::get<I>(s).resize(batch), 0)... };
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok && (std::get<I>(a) = make_global(env,
+                    soa::array_of<typename Fields::type>::create(env, static_cast<jsize>(batch)))) != nullptr, 0)... };
+                return ok;
+            }
+            template<typename A>
+            static A make_global(JNIEnv* env, A local){
+                if(local == nullptr) return nullptr;
+                auto global = static_cast<A>(env->NewGlobalRef(local));
+                env->DeleteLocalRef(local);
+                return global;
+            }
+            template<std::size_t... I>
+            static void release(JNIEnv* env, arrays& a, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (env->DeleteGlobalRef(std::get<I>(a)), 0)... };
+            }
+            template<std::size_t... I>
+            static void scatter(staging& s, std::size_t i, Event const& e, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (std::get<I>(s)[i] = Fields::get(e), 0)... };
+            }
+            template<std::size_t... I>
+            void deliver(JNIEnv* env, arrays& a, staging& s, jsize n, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (
+                    soa::array_of<typename Fields::type>::set(env, std::get<I>(a), n, std::get<I>(s).data()), 0)... };
+                on_batch(listener, n, std::get<I>(a)...);
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    env->ExceptionClear();
+                    failed_batches.fetch_add(1, std::memory_order_relaxed);
+                }
+                else{
+                    delivered_batches.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            void park(){
+                std::unique_lock<std::mutex> guard{ lock };
+                parked.store(true, std::memory_order_seq_cst);
+                wake.wait(guard, [this]{ return stopping.load() || events.ready(); });
+                parked.store(false, std::memory_order_relaxed);
+            }
+            void signal(){
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                }
+                wake.notify_one();
+            }
+            void run(JNIEnv* env, arrays& a, staging& s){
+                on_batch.rebind(env);
+                Event e;
+                for(;;){
+                    // Read before draining, so events pushed before stop()
+                    // are always delivered.
+                    bool last = stopping.load(std::memory_order_acquire);
+                    std::size_t n = 0;
+                    while(n < batch && events.pop(e)){
+                        scatter(s, n++, e, indices{});
+                    }
+                    if(n != 0){
+                        deliver(env, a, s, static_cast<jsize>(n), indices{});
+                    }
+                    else if(last){
+                        break;
+                    }
+                    else{
+                        park();
+                    }
+                }
+            }
+
+        public:
+            // Starts the drainer; listener must be a global reference that
+            // outlives the pump. Returns null if the thread cannot attach or
+            // its arrays cannot be allocated.
+            static std::unique_ptr<pump> start(JavaVM* vm, jobject listener, method<void> on_batch,
+                    std::size_t batch = 1024){
+                std::unique_ptr<pump> p{ new pump{ vm, listener, on_batch, batch } };
+                std::promise<bool> started;
+                auto ok = started.get_future();
+                // The promise moves into the thread: set_value may still be
+                // running when start() returns.
+                p->thread = std::thread{ [q = p.get(), started = std::move(started)]() mutable {
+                    JNIEnv* e = nullptr;
+                    if(q->vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&e), nullptr) != JNI_OK){
+                        started.set_value(false);
+                        return;
+                    }
+                    arrays a{};
+                    staging s;
+                    if(q->allocate(e, a, s, indices{})){
+                        started.set_value(true);
+                        q->run(e, a, s);
+                        release(e, a, indices{});
+                    }
+                    else{
+                        e->ExceptionClear();
+                        release(e, a, indices{});
+                        started.set_value(false);
+                    }
+                    q->vm->DetachCurrentThread();
+                } };
+                if(!ok.get()){
+                    p->thread.join();
+                    return nullptr;
+                }
+                return p;
+            }
+            pump(pump const&) = delete;
+            pump& operator=(pump const&) = delete;
+            // Delivers everything pushed so far, then detaches.
+            ~pump(){
+                stopping.store(true);
+                signal();
+                if(thread.joinable()) thread.join();
+            }
+
+            bool push(Event const& e) noexcept {
+                if(!events.push(e)) return false;
+                if(parked.load(std::memory_order_seq_cst)) signal();
+                return true;
+            }
+            std::uint64_t dropped() const noexcept {
+                return events.dropped();
+            }
+            std::uint64_t delivered() const noexcept {
+                return delivered_batches.load(std::memory_order_relaxed);
+            }
+            // Batches whose listener call threw; the exception is cleared.
+            std::uint64_t failed() const noexcept {
+                return failed_batches.load(std::memory_order_relaxed);
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_EVENTS_HPP
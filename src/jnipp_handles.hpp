@@ -0,0 +1,193 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_handles.hpp
+//! \brief   JNI++ jlong handles to native peer objects
+//!
+//! A registry owns native peers and gives Java a jlong handle for each
+//! instead of a raw pointer: the low 32 bits index a slot, the high 32 bits
+//! carry the slot's generation, so a handle that was released, or never
+//! issued, resolves to null instead of freed memory:
+//!
+//!   static jnipp::handles::registry<session> sessions;
+//!   jlong open(JNIEnv*, jclass){ return sessions.insert(std::make_unique<session>()); }
+//!   void send(JNIEnv* env, jobject, jlong h, jint n){
+//!       jnipp::native_entry(env, [&]{ sessions.at(h).send(n); });  // IllegalArgumentException
+//!   }
+//!   void close(JNIEnv*, jobject, jlong h){ sessions.release(h); }
+//!
+//! Resolution takes no lock and writes no shared memory, so it scales with
+//! the number of threads calling in. release() hands the peer back without
+//! waiting for them; destroy it only once no native call can still be using
+//! it, e.g. from the close() that is the last call on the Java object.
+//!
+//! A handle is never 0, so Java can keep 0 for "closed".
+//=============================================================================
+#ifndef JNIPP_JNIPP_HANDLES_HPP
+#define JNIPP_JNIPP_HANDLES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace handles {
+        template<typename T>
+        class registry {
+        public:
+            static constexpr std::size_t chunk_size = 4096;
+            static constexpr std::size_t max_chunks = 4096;
+
+        private:
+            // An odd generation marks a live slot. Generations only grow, and
+            // a slot whose generation would wrap is retired rather than reused.
+            struct slot {
+                std::atomic<std::uint32_t> generation{ 0 };
+                std::atomic<T*> peer{ nullptr };
+                std::atomic<std::uint32_t> next_free{ 0 };
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                // Written by insert() and read by release(), which the
+                // generation orders.
+                std::size_t bytes = 0;
+#endif
+            };
+            static constexpr std::uint32_t no_slot = 0xffffffff;
+            static constexpr std::uint32_t last_generation = 0xfffffffd;
+
+            // Chunks never move, so a slot reference stays valid without a
+            // lock while others are being added.
+            std::unique_ptr<std::atomic<slot*>[]> chunks{ new std::atomic<slot*>[max_chunks]() };
+            std::atomic<std::uint32_t> used{ 0 };
+            // Tagged free list: (tag << 32) | index, the tag defeating ABA.
+            std::atomic<std::uint64_t> free_head{ no_slot };
+
+            static std::uint32_t index_of(jlong h) noexcept {
+                return static_cast<std::uint32_t>(static_cast<std::uint64_t>(h));
+            }
+            static std::uint32_t generation_of(jlong h) noexcept {
+                return static_cast<std::uint32_t>(static_cast<std::uint64_t>(h) >> 32);
+            }
+            slot* find(std::uint32_t index) const noexcept {
+                if(index / chunk_size >= max_chunks) return nullptr;
+                slot* c = chunks[index / chunk_size].load(std::memory_order_acquire);
+                return c == nullptr ? nullptr : c + index % chunk_size;
+            }
+            slot* chunk_for(std::uint32_t index){
+                auto& c = chunks[index / chunk_size];
+                slot* s = c.load(std::memory_order_acquire);
+                if(s == nullptr){
+                    slot* fresh = new slot[chunk_size];
+                    if(c.compare_exchange_strong(s, fresh, std::memory_order_acq_rel)){
+                        s = fresh;
+                    }
+                    else{
+                        delete[] fresh;
+                    }
+                }
+                return s + index % chunk_size;
+            }
+            std::uint32_t pop_free() noexcept {
+                auto head = free_head.load(std::memory_order_acquire);
+                for(;;){
+                    auto index = static_cast<std::uint32_t>(head);
+                    if(index == no_slot) return no_slot;
+                    auto next = find(index)->next_free.load(std::memory_order_relaxed);
+                    auto tagged = ((head >> 32) + 1) << 32 | next;
+                    if(free_head.compare_exchange_weak(head, tagged, std::memory_order_acquire)) return index;
+                }
+            }
+            void push_free(std::uint32_t index, slot& s) noexcept {
+                auto head = free_head.load(std::memory_order_relaxed);
+                for(;;){
+                    s.next_free.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+                    auto tagged = ((head >> 32) + 1) << 32 | index;
+                    if(free_head.compare_exchange_weak(head, tagged, std::memory_order_release)) return;
+                }
+            }
+
+        public:
+            registry() = default;
+            registry(registry const&) = delete;
+            registry& operator=(registry const&) = delete;
+            // Destroys the peers still registered.
+            ~registry(){
+                for(std::size_t c = 0; c < max_chunks; ++c){
+                    slot* s = chunks[c].load(std::memory_order_relaxed);
+                    if(s == nullptr) continue;
+                    for(std::size_t i = 0; i < chunk_size; ++i){
+                        if((s[i].generation.load(std::memory_order_relaxed) & 1) == 0) continue;
+                        delete s[i].peer.load(std::memory_order_relaxed);
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                        memory::release(memory::peer, s[i].bytes);
+#endif
+                    }
+                    delete[] s;
+                }
+            }
+
+            // Takes ownership; returns 0, destroying the peer, only when
+            // every index is in use.
+            jlong insert(std::unique_ptr<T> peer){
+                auto index = pop_free();
+                if(index == no_slot){
+                    index = used.fetch_add(1, std::memory_order_relaxed);
+                    if(index / chunk_size >= max_chunks){
+                        used.fetch_sub(1, std::memory_order_relaxed);
+                        return 0;
+                    }
+                }
+                slot* s = chunk_for(index);
+                auto generation = s->generation.load(std::memory_order_relaxed) + 1;
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                s->bytes = peer ? memory::footprint<T>::of(*peer) : 0;
+                memory::acquire(memory::peer, s->bytes);
+#endif
+                s->peer.store(peer.release(), std::memory_order_relaxed);
+                s->generation.store(generation, std::memory_order_release);
+                return static_cast<jlong>(static_cast<std::uint64_t>(generation) << 32 | index);
+            }
+
+            // The peer, or null if the handle is stale or was never issued.
+            T* get(jlong h) const noexcept {
+                slot* s = find(index_of(h));
+                if(s == nullptr) return nullptr;
+                auto generation = generation_of(h);
+                if((generation & 1) == 0 || s->generation.load(std::memory_order_acquire) != generation) return nullptr;
+                // The acquire keeps the recheck from moving above the load.
+                T* p = s->peer.load(std::memory_order_acquire);
+                return s->generation.load(std::memory_order_relaxed) == generation ? p : nullptr;
+            }
+            T& at(jlong h) const {
+                T* p = get(h);
+                if(p == nullptr) throw std::invalid_argument("Stale handle in handles::registry::at function.");
+                return *p;
+            }
+
+            // Unregisters the peer and returns it; null if the handle is
+            // stale, so a second release of the same handle is harmless.
+            std::unique_ptr<T> release(jlong h) noexcept {
+                auto index = index_of(h);
+                slot* s = find(index);
+                auto generation = generation_of(h);
+                if(s == nullptr || (generation & 1) == 0) return nullptr;
+                if(!s->generation.compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel)) return nullptr;
+                std::unique_ptr<T> peer{ s->peer.exchange(nullptr, std::memory_order_relaxed) };
+#ifdef JNIPP_ENABLE_MEMORY_ACCOUNTING
+                memory::release(memory::peer, s->bytes);
+#endif
+                if(generation + 1 < last_generation) push_free(index, *s);
+                return peer;
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_HANDLES_HPP
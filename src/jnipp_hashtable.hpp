@@ -0,0 +1,360 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_hashtable.hpp
+//! \brief   JNI++ concurrent hash table in a direct ByteBuffer
+//!
+//! An open-addressing table with fixed-width keys and values, in plain
+//! memory that Java reaches through a direct ByteBuffer, so lookups from
+//! either side never cross JNI. Any thread on either side may read or write.
+//!
+//! Layout, native byte order, the region 64-byte aligned:
+//!
+//!   offset   size  field
+//!        0      8  capacity     slots, a power of two
+//!        8      4  magic        0x4a4e4854 ("JNHT")
+//!       12      4  version      1
+//!       16      4  key bytes
+//!       20      4  value bytes
+//!       24      4  slot bytes   8 + key and value each padded to 8
+//!       64  slots  slot i at 64 + i * slot bytes
+//!
+//! A slot is a 64-bit state word, (generation << 2) | state, then the key
+//! and the value, zero padded. States: 0 empty, 1 busy, 2 full, 3 erased.
+//! A key is written once, when its slot is claimed, and never moves; an
+//! erased slot keeps its key, so capacity bounds the distinct keys ever
+//! inserted.
+//!
+//! Key k starts probing at hash(k) & (capacity - 1) and moves to the next
+//! slot until it finds k or an empty slot. hash folds the key's 64-bit words
+//! w into h = 0x9e3779b97f4a7c15 as h = fmix64(h ^ w), fmix64 being the
+//! MurmurHash3 finalizer.
+//!
+//! Writers compareAndSet the state word from a non-busy value to busy, write
+//! the key (only when claiming an empty slot) and value, then setRelease it
+//! with the generation incremented. Readers getAcquire the word, wait while
+//! it is busy with generation 0, compare the key, then read the value with
+//! getAcquire and accept it if the word has not changed. With
+//!
+//!   static final VarHandle LONG = MethodHandles.byteBufferViewVarHandle(
+//!       long[].class, ByteOrder.nativeOrder());
+//!
+//! every access to the table is LONG.getAcquire, setRelease or
+//! compareAndSet on an 8-byte word.
+//=============================================================================
+#ifndef JNIPP_JNIPP_HASHTABLE_HPP
+#define JNIPP_JNIPP_HASHTABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace hashtable {
+        constexpr std::size_t cache_line = 64;
+        constexpr std::uint32_t magic = 0x4a4e4854;
+        constexpr std::uint32_t version = 1;
+
+        struct header {
+            std::uint64_t capacity;
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t key_bytes;
+            std::uint32_t value_bytes;
+            std::uint32_t slot_bytes;
+            char pad[cache_line - sizeof(std::uint64_t) - 5 * sizeof(std::uint32_t)];
+        };
+        static_assert(offsetof(header, key_bytes) == 16 && offsetof(header, slot_bytes) == 24 &&
+            sizeof(header) == 64, "Hash table layout changed.");
+        static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t),
+            "The hash table layout needs plain 64-bit atomics.");
+
+        enum class state : std::uint64_t {
+            empty = 0,
+            busy = 1,
+            full = 2,
+            erased = 3,
+        };
+
+        inline std::uint64_t hash(std::uint64_t const* words, std::size_t n) noexcept {
+            std::uint64_t h = 0x9e3779b97f4a7c15;
+            for(std::size_t i = 0; i < n; ++i){
+                h ^= words[i];
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccd;
+                h ^= h >> 33;
+                h *= 0xc4ceb9fe1a85ec53;
+                h ^= h >> 33;
+            }
+            return h;
+        }
+
+        template<typename Key, typename Value>
+        class view;
+        template<typename Key, typename Value>
+        view<Key, Value> format(void* memory, std::uint64_t capacity) noexcept;
+        template<typename Key, typename Value>
+        view<Key, Value> open(void* memory, std::size_t bytes) noexcept;
+
+        template<typename Key, typename Value>
+        class view {
+            static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                "Keys and values must be trivially copyable.");
+        public:
+            static constexpr std::size_t key_words = (sizeof(Key) + 7) / 8;
+            static constexpr std::size_t value_words = (sizeof(Value) + 7) / 8;
+            static constexpr std::size_t slot_words = 1 + key_words + value_words;
+            // Total bytes of a table with the given number of slots.
+            static std::size_t bytes_for(std::uint64_t capacity) noexcept {
+                return sizeof(header) + static_cast<std::size_t>(capacity) * slot_words * sizeof(std::uint64_t);
+            }
+
+        private:
+            using word = std::atomic<std::uint64_t>;
+
+            header* h = nullptr;
+            word* slots = nullptr;
+            std::uint64_t mask = 0;
+
+            view(header* h) noexcept
+                : h{ h }, slots{ reinterpret_cast<word*>(h + 1) }, mask{ h->capacity - 1 } {}
+
+            friend view format<Key, Value>(void*, std::uint64_t) noexcept;
+            friend view open<Key, Value>(void*, std::size_t) noexcept;
+
+            static state state_of(std::uint64_t w) noexcept {
+                return static_cast<state>(w & 3);
+            }
+            static std::uint64_t with(std::uint64_t generation, state s) noexcept {
+                return (generation << 2) | static_cast<std::uint64_t>(s);
+            }
+            template<typename T, std::size_t N>
+            static void to_words(T const& v, std::uint64_t (&out)[N]) noexcept {
+                std::memset(out, 0, sizeof(out));
+                std::memcpy(out, &v, sizeof(T));
+            }
+            word* slot(std::uint64_t i) const noexcept {
+                return slots + (i & mask) * slot_words;
+            }
+            // Only a claim publishes a key, so a reader never waits on a
+            // slot whose value alone is being replaced.
+            static std::uint64_t settled(word* s) noexcept {
+                auto w = s->load(std::memory_order_acquire);
+                while(w == with(0, state::busy)){
+                    std::this_thread::yield();
+                    w = s->load(std::memory_order_acquire);
+                }
+                return w;
+            }
+            static bool holds(word* s, std::uint64_t const (&key)[key_words]) noexcept {
+                for(std::size_t i = 0; i < key_words; ++i){
+                    if(s[1 + i].load(std::memory_order_relaxed) != key[i]) return false;
+                }
+                return true;
+            }
+            // The slot holding key; with claim, an empty slot is claimed for
+            // it instead and returned busy. nullptr if absent or full.
+            word* locate(std::uint64_t const (&key)[key_words], bool claim, bool& claimed) const noexcept {
+                auto i = hash(key, key_words);
+                for(std::uint64_t n = 0; n <= mask; ++n, ++i){
+                    word* s = slot(i);
+                    auto w = settled(s);
+                    while(w == with(0, state::empty)){
+                        if(!claim) return nullptr;
+                        if(s->compare_exchange_weak(w, with(0, state::busy), std::memory_order_acquire)){
+                            for(std::size_t k = 0; k < key_words; ++k){
+                                s[1 + k].store(key[k], std::memory_order_relaxed);
+                            }
+                            claimed = true;
+                            return s;
+                        }
+                        if(w == with(0, state::busy)) w = settled(s);
+                    }
+                    if(holds(s, key)) return s;
+                }
+                return nullptr;
+            }
+            // Takes a published slot busy; returns the word it replaced.
+            static std::uint64_t lock(word* s) noexcept {
+                auto w = s->load(std::memory_order_relaxed);
+                for(;;){
+                    if(state_of(w) == state::busy){
+                        std::this_thread::yield();
+                        w = s->load(std::memory_order_relaxed);
+                    }
+                    else if(s->compare_exchange_weak(w, (w & ~std::uint64_t{ 3 }) | static_cast<std::uint64_t>(state::busy),
+                            std::memory_order_acquire, std::memory_order_relaxed)){
+                        return w;
+                    }
+                }
+            }
+
+        public:
+            view() noexcept = default;
+            explicit operator bool() const noexcept {
+                return h != nullptr;
+            }
+            void* memory() const noexcept {
+                return h;
+            }
+            std::uint64_t capacity() const noexcept {
+                return mask + 1;
+            }
+            std::size_t size_bytes() const noexcept {
+                return bytes_for(capacity());
+            }
+
+            bool find(Key const& k, Value& out) const noexcept {
+                std::uint64_t key[key_words];
+                to_words(k, key);
+                bool claimed = false;
+                word* s = locate(key, false, claimed);
+                if(s == nullptr) return false;
+                std::uint64_t value[value_words];
+                for(;;){
+                    auto w = s->load(std::memory_order_acquire);
+                    if(state_of(w) == state::busy){
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    if(state_of(w) == state::erased) return false;
+                    // Acquire loads keep the recheck below from moving up.
+                    for(std::size_t i = 0; i < value_words; ++i){
+                        value[i] = s[1 + key_words + i].load(std::memory_order_acquire);
+                    }
+                    if(s->load(std::memory_order_relaxed) == w) break;
+                }
+                std::memcpy(&out, value, sizeof(Value));
+                return true;
+            }
+            // Returns false only when the key is new and no slot is left.
+            bool assign(Key const& k, Value const& v) noexcept {
+                std::uint64_t key[key_words];
+                std::uint64_t value[value_words];
+                to_words(k, key);
+                to_words(v, value);
+                bool claimed = false;
+                word* s = locate(key, true, claimed);
+                if(s == nullptr) return false;
+                auto w = claimed ? with(0, state::busy) : lock(s);
+                for(std::size_t i = 0; i < value_words; ++i){
+                    s[1 + key_words + i].store(value[i], std::memory_order_release);
+                }
+                s->store(with((w >> 2) + 1, state::full), std::memory_order_release);
+                return true;
+            }
+            bool erase(Key const& k) noexcept {
+                std::uint64_t key[key_words];
+                to_words(k, key);
+                bool claimed = false;
+                word* s = locate(key, false, claimed);
+                if(s == nullptr) return false;
+                auto w = lock(s);
+                if(state_of(w) != state::full){
+                    s->store(w, std::memory_order_release);
+                    return false;
+                }
+                s->store(with((w >> 2) + 1, state::erased), std::memory_order_release);
+                return true;
+            }
+        };
+
+        // Lays out an empty table. memory must be 64-byte aligned and
+        // bytes_for(capacity) long; capacity a power of two.
+        template<typename Key, typename Value>
+        view<Key, Value> format(void* memory, std::uint64_t capacity) noexcept {
+            if(memory == nullptr || reinterpret_cast<std::uintptr_t>(memory) % cache_line != 0 ||
+               capacity == 0 || (capacity & (capacity - 1)) != 0){
+                return view<Key, Value>{};
+            }
+            std::memset(memory, 0, view<Key, Value>::bytes_for(capacity));
+            auto h = static_cast<header*>(memory);
+            h->capacity = capacity;
+            h->magic = magic;
+            h->version = version;
+            h->key_bytes = static_cast<std::uint32_t>(sizeof(Key));
+            h->value_bytes = static_cast<std::uint32_t>(sizeof(Value));
+            h->slot_bytes = static_cast<std::uint32_t>(view<Key, Value>::slot_words * sizeof(std::uint64_t));
+            return view<Key, Value>{ h };
+        }
+        // Adopts a table already laid out for Key and Value, by format() or
+        // by the Java side.
+        template<typename Key, typename Value>
+        view<Key, Value> open(void* memory, std::size_t bytes) noexcept {
+            if(memory == nullptr || reinterpret_cast<std::uintptr_t>(memory) % cache_line != 0 ||
+               bytes < sizeof(header)){
+                return view<Key, Value>{};
+            }
+            auto h = static_cast<header*>(memory);
+            auto capacity = h->capacity;
+            if(h->magic != magic || h->version != version || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+               h->key_bytes != sizeof(Key) || h->value_bytes != sizeof(Value) ||
+               h->slot_bytes != view<Key, Value>::slot_words * sizeof(std::uint64_t) ||
+               capacity > (bytes - sizeof(header)) / h->slot_bytes){
+                return view<Key, Value>{};
+            }
+            return view<Key, Value>{ h };
+        }
+
+        // Owns the memory of a table. It must outlive every Java buffer
+        // created over it.
+        template<typename Key, typename Value>
+        class buffer {
+        private:
+            void* memory;
+            view<Key, Value> v;
+        public:
+            // capacity is rounded up to a power of two of at least 8. Keep
+            // it well above the number of keys: probes lengthen as it fills.
+            explicit buffer(std::uint64_t capacity){
+                std::uint64_t c = 8;
+                while(c < capacity) c <<= 1;
+                auto bytes = view<Key, Value>::bytes_for(c) + cache_line;
+                memory = ::operator new(bytes);
+                JNIPP_MEMORY_ACQUIRE(hashtable, bytes);
+                auto aligned = (reinterpret_cast<std::uintptr_t>(memory) + cache_line - 1) & ~std::uintptr_t{ cache_line - 1 };
+                v = format<Key, Value>(reinterpret_cast<void*>(aligned), c);
+            }
+            buffer(buffer const&) = delete;
+            buffer& operator=(buffer const&) = delete;
+            ~buffer(){
+                JNIPP_MEMORY_RELEASE(hashtable, v.size_bytes() + cache_line);
+                ::operator delete(memory);
+            }
+            view<Key, Value>& get() noexcept {
+                return v;
+            }
+        };
+
+        // A direct ByteBuffer over the whole table, header included.
+        template<typename Key, typename Value>
+        jni_expected<jobject> to_java(JNIEnv* env, view<Key, Value> const& v){
+            jobject b = env->NewDirectByteBuffer(v.memory(), static_cast<jlong>(v.size_bytes()));
+            if(b == NULL){
+                return jni_raise(env, "NewDirectByteBuffer failed in hashtable::to_java function.");
+            }
+            return b;
+        }
+        // The table inside a direct ByteBuffer laid out by the other side.
+        template<typename Key, typename Value>
+        jni_expected<view<Key, Value>> from_java(JNIEnv* env, jobject buffer){
+            auto v = open<Key, Value>(env->GetDirectBufferAddress(buffer),
+                static_cast<std::size_t>(env->GetDirectBufferCapacity(buffer)));
+            if(!v){
+                return jni_raise(env, "Not a hash table for these types in hashtable::from_java function.");
+            }
+            return v;
+        }
+    }
+}
+#endif // JNIPP_JNIPP_HASHTABLE_HPP
@@ -0,0 +1,201 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_lookup_profile.hpp
+//! \brief   JNI++ startup profiler for class, method and field lookups
+//!
+//! Included by jnipp.hpp when JNIPP_ENABLE_LOOKUP_PROFILE is defined; like
+//! JNIPP_ENABLE_TRACE it changes the layout of clas. Recording is off until
+//! start() opens a window, typically first thing in JNI_OnLoad:
+//!
+//!   jnipp::lookup_profile::start(std::chrono::seconds{ 30 });
+//!   ...
+//!   jnipp::lookup_profile::print_report(stderr);
+//=============================================================================
+#ifndef JNIPP_JNIPP_LOOKUP_PROFILE_HPP
+#define JNIPP_JNIPP_LOOKUP_PROFILE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "jnipp_names.hpp"
+
+namespace jnipp {
+    namespace lookup_profile {
+        enum class kind : std::uint8_t {
+            clas,
+            method,
+            field,
+        };
+
+        // All lookups of one class or member during the window.
+        struct lookup {
+            kind what;
+            char const* clas;
+            char const* name;
+            char const* signature;
+            std::uint64_t count;
+            std::uint64_t total_ns;
+            std::uint64_t max_ns;
+            // Offset of the first lookup from start().
+            std::uint64_t first_ns;
+        };
+
+        // A class and all lookups of its members.
+        struct class_cost {
+            char const* clas;
+            std::uint64_t lookups;
+            std::uint64_t total_ns;
+        };
+
+        namespace detail {
+            using clock = std::chrono::steady_clock;
+            using key = std::tuple<kind, char const*, char const*, char const*>;
+
+            struct state {
+                std::atomic<bool> active{ false };
+                std::mutex lock;
+                clock::time_point origin;
+                clock::time_point deadline;
+                std::map<key, lookup> lookups;
+
+                static state& instance(){
+                    static state s;
+                    return s;
+                }
+            };
+
+            inline std::uint64_t ns(clock::duration d) noexcept {
+                return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+            }
+        }
+
+        // Clears previous results and records lookups for the given window.
+        inline void start(std::chrono::nanoseconds window){
+            auto& s = detail::state::instance();
+            std::lock_guard<std::mutex> guard{ s.lock };
+            s.lookups.clear();
+            s.origin = detail::clock::now();
+            s.deadline = s.origin + window;
+            s.active.store(true, std::memory_order_release);
+        }
+        // Taken under the lock, so no lookup is recorded once stop() returns.
+        inline void stop(){
+            auto& s = detail::state::instance();
+            std::lock_guard<std::mutex> guard{ s.lock };
+            s.active.store(false, std::memory_order_release);
+        }
+        inline bool active() noexcept {
+            return detail::state::instance().active.load(std::memory_order_relaxed);
+        }
+
+        inline void record(kind what, char const* clas, char const* name, char const* signature,
+                detail::clock::time_point begin, detail::clock::time_point end){
+            auto& s = detail::state::instance();
+            std::lock_guard<std::mutex> guard{ s.lock };
+            // The scope saw the window open, but stop() may have run since.
+            if(!s.active.load(std::memory_order_relaxed)) return;
+            if(end > s.deadline){
+                s.active.store(false, std::memory_order_release);
+                return;
+            }
+            // Interned so equal names from different strings share a key.
+            detail::key k{ what, names::intern(clas), names::intern(name), names::intern(signature) };
+            auto it = s.lookups.find(k);
+            if(it == s.lookups.end()){
+                it = s.lookups.emplace(k, lookup{ what, std::get<1>(k), std::get<2>(k), std::get<3>(k),
+                    0, 0, 0, detail::ns(begin - s.origin) }).first;
+            }
+            auto d = detail::ns(end - begin);
+            it->second.count += 1;
+            it->second.total_ns += d;
+            it->second.max_ns = std::max(it->second.max_ns, d);
+        }
+
+        // Times one lookup while a window is open; otherwise costs a
+        // single relaxed load.
+        class scope {
+        private:
+            kind what;
+            char const* clas;
+            char const* name;
+            char const* signature;
+            bool on;
+            detail::clock::time_point begin;
+        public:
+            scope(kind what, char const* clas, char const* name, char const* signature) noexcept
+                : what{ what }, clas{ clas }, name{ name }, signature{ signature }, on{ active() } {
+                if(on) begin = detail::clock::now();
+            }
+            scope(scope const&) = delete;
+            scope& operator=(scope const&) = delete;
+            ~scope(){
+                if(on) record(what, clas, name, signature, begin, detail::clock::now());
+            }
+        };
+
+        // Every distinct lookup, most expensive first.
+        inline std::vector<lookup> by_lookup(){
+            auto& s = detail::state::instance();
+            std::vector<lookup> out;
+            {
+                std::lock_guard<std::mutex> guard{ s.lock };
+                for(auto& x : s.lookups) out.push_back(x.second);
+            }
+            std::sort(out.begin(), out.end(), [](lookup const& a, lookup const& b){
+                return a.total_ns > b.total_ns;
+            });
+            return out;
+        }
+
+        // Lookup cost charged to the class it concerns, most expensive first.
+        inline std::vector<class_cost> by_class(){
+            std::map<char const*, class_cost> classes;
+            for(auto& x : by_lookup()){
+                auto& c = classes.emplace(x.clas, class_cost{ x.clas, 0, 0 }).first->second;
+                c.lookups += x.count;
+                c.total_ns += x.total_ns;
+            }
+            std::vector<class_cost> out;
+            for(auto& x : classes) out.push_back(x.second);
+            std::sort(out.begin(), out.end(), [](class_cost const& a, class_cost const& b){
+                return a.total_ns > b.total_ns;
+            });
+            return out;
+        }
+
+        inline void print_report(std::FILE* f){
+            static char const* const kinds[] = { "class", "method", "field" };
+            std::uint64_t total = 0;
+            auto lookups = by_lookup();
+            for(auto& x : lookups) total += x.total_ns;
+            std::fprintf(f, "jnipp lookups: %zu distinct, %.3f ms total\n",
+                lookups.size(), static_cast<double>(total) / 1e6);
+            std::fprintf(f, "%12s %8s  %s\n", "total_us", "lookups", "class");
+            for(auto& c : by_class()){
+                std::fprintf(f, "%12.1f %8llu  %s\n", static_cast<double>(c.total_ns) / 1e3,
+                    static_cast<unsigned long long>(c.lookups), c.clas);
+            }
+            std::fprintf(f, "%12s %8s %10s %10s  %s\n", "total_us", "count", "max_us", "first_ms", "lookup");
+            for(auto& x : lookups){
+                std::fprintf(f, "%12.1f %8llu %10.1f %10.3f  %s %s%s%s %s\n",
+                    static_cast<double>(x.total_ns) / 1e3, static_cast<unsigned long long>(x.count),
+                    static_cast<double>(x.max_ns) / 1e3, static_cast<double>(x.first_ns) / 1e6,
+                    kinds[static_cast<int>(x.what)], x.clas, *x.name ? "." : "", x.name, x.signature);
+            }
+        }
+    }
+}
+#endif // JNIPP_JNIPP_LOOKUP_PROFILE_HPP
@@ -0,0 +1,251 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_memory.hpp
+//! \brief   JNI++ accounting of native memory held for Java
+//!
+//! Included by jnipp.hpp when JNIPP_ENABLE_MEMORY_ACCOUNTING is defined.
+//! The GC cannot see native memory, so the jnipp peers and buffers that
+//! Java keeps alive count their bytes here, per category: registered peers,
+//! rings, hash tables, columnar batches and mapped files. Code of its own
+//! reports through acquire() and release() with categories from user on.
+//! A registered peer counts footprint<T>::of(peer) from insert() until
+//! release(), a columnar batch its reserved capacity as of its last
+//! to_java().
+//!
+//! When a category, or the total, rises past its threshold, a pressure hook
+//! calls Java from its own attached thread, never from the allocating one:
+//!
+//!   jnipp::memory::set_threshold(jnipp::memory::peer, 512 << 20);
+//!   jnipp::memory::set_total_threshold(std::int64_t{ 2 } << 30);
+//!   // Java: void onNativeMemoryPressure(int category, long bytes, long threshold)
+//!   auto hook = jnipp::memory::pressure_hook::start(vm, global_listener);
+//!
+//! category is -1 for the total. The hook fires again only after usage has
+//! dropped back below the threshold.
+//=============================================================================
+#ifndef JNIPP_JNIPP_MEMORY_HPP
+#define JNIPP_JNIPP_MEMORY_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <jni.h>
+
+#ifndef JNIPP_MEMORY_CATEGORIES
+// Built-in categories plus those available from user on.
+#define JNIPP_MEMORY_CATEGORIES 16
+#endif
+
+namespace jnipp {
+    namespace memory {
+        enum category : std::uint8_t {
+            peer,
+            ring,
+            hashtable,
+            columnar,
+            mapped,
+            user,
+        };
+        constexpr std::size_t category_count = JNIPP_MEMORY_CATEGORIES;
+        static_assert(category_count > user && category_count < 32, "JNIPP_MEMORY_CATEGORIES must be in 6..31.");
+
+        struct usage {
+            std::int64_t bytes;
+            std::int64_t peak;
+            std::int64_t threshold;
+        };
+
+        // Bytes a registered peer of type T holds; specialize for peers
+        // that own more than their own object.
+        template<typename T>
+        struct footprint {
+            static std::size_t of(T const&) noexcept {
+                return sizeof(T);
+            }
+        };
+
+        namespace detail {
+            struct counter {
+                std::atomic<std::int64_t> bytes{ 0 };
+                std::atomic<std::int64_t> peak{ 0 };
+                std::atomic<std::int64_t> threshold{ 0 };
+
+                // Returns true when this addition crossed the threshold.
+                bool add(std::int64_t n) noexcept {
+                    auto now = bytes.fetch_add(n, std::memory_order_relaxed) + n;
+                    auto p = peak.load(std::memory_order_relaxed);
+                    while(now > p && !peak.compare_exchange_weak(p, now, std::memory_order_relaxed)){}
+                    auto t = threshold.load(std::memory_order_relaxed);
+                    return t > 0 && now >= t && now - n < t;
+                }
+                usage get() const noexcept {
+                    return usage{ bytes.load(std::memory_order_relaxed), peak.load(std::memory_order_relaxed),
+                        threshold.load(std::memory_order_relaxed) };
+                }
+            };
+
+            // Bit i of pending: category i crossed; bit category_count: the
+            // total did.
+            struct state {
+                counter categories[category_count];
+                counter total;
+                std::atomic<std::uint32_t> pending{ 0 };
+                std::mutex lock;
+                std::condition_variable wake;
+
+                static state& instance(){
+                    static state s;
+                    return s;
+                }
+                // Called from the noexcept acquire(). Locking only fails on a
+                // broken mutex; the bits are already pending then, and the
+                // notification goes out unlocked, at worst to be picked up
+                // with the next crossing.
+                void signal(std::uint32_t bits) noexcept {
+                    pending.fetch_or(bits, std::memory_order_release);
+                    try{
+                        std::lock_guard<std::mutex> guard{ lock };
+                        wake.notify_all();
+                    }catch(std::system_error const&){
+                        wake.notify_all();
+                    }
+                }
+            };
+        }
+
+        // Counters are relaxed atomics; only a threshold crossing takes a lock.
+        inline void acquire(category c, std::size_t bytes) noexcept {
+            auto& s = detail::state::instance();
+            auto n = static_cast<std::int64_t>(bytes);
+            std::uint32_t bits = 0;
+            if(s.categories[c].add(n)) bits |= std::uint32_t{ 1 } << c;
+            if(s.total.add(n)) bits |= std::uint32_t{ 1 } << category_count;
+            if(bits != 0) s.signal(bits);
+        }
+        inline void release(category c, std::size_t bytes) noexcept {
+            auto& s = detail::state::instance();
+            auto n = static_cast<std::int64_t>(bytes);
+            s.categories[c].bytes.fetch_sub(n, std::memory_order_relaxed);
+            s.total.bytes.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+        inline usage get(category c) noexcept {
+            return detail::state::instance().categories[c].get();
+        }
+        inline usage total() noexcept {
+            return detail::state::instance().total.get();
+        }
+        // 0 disables the hook for the category.
+        inline void set_threshold(category c, std::int64_t bytes) noexcept {
+            detail::state::instance().categories[c].threshold.store(bytes, std::memory_order_relaxed);
+        }
+        inline void set_total_threshold(std::int64_t bytes) noexcept {
+            detail::state::instance().total.threshold.store(bytes, std::memory_order_relaxed);
+        }
+
+        // Delivers threshold crossings to a Java listener. Run one at a time.
+        class pressure_hook {
+        private:
+            JavaVM* vm;
+            jobject listener;
+            jmethodID on_pressure = nullptr;
+            bool stopping = false;
+            std::atomic<std::uint64_t> failed_calls{ 0 };
+            std::thread thread;
+
+            pressure_hook(JavaVM* vm, jobject listener)
+                : vm{ vm }, listener{ listener } {}
+
+            void notify(JNIEnv* env, jint c, usage u){
+                env->CallVoidMethod(listener, on_pressure, c, static_cast<jlong>(u.bytes), static_cast<jlong>(u.threshold));
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    env->ExceptionClear();
+                    failed_calls.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            void run(JNIEnv* env){
+                auto& s = detail::state::instance();
+                for(;;){
+                    {
+                        std::unique_lock<std::mutex> guard{ s.lock };
+                        s.wake.wait(guard, [&]{ return stopping || s.pending.load(std::memory_order_acquire) != 0; });
+                        if(stopping) return;
+                    }
+                    auto bits = s.pending.exchange(0, std::memory_order_acquire);
+                    for(std::size_t c = 0; c < category_count; ++c){
+                        if(bits & (std::uint32_t{ 1 } << c)) notify(env, static_cast<jint>(c), s.categories[c].get());
+                    }
+                    if(bits & (std::uint32_t{ 1 } << category_count)) notify(env, -1, s.total.get());
+                }
+            }
+
+        public:
+            // listener must be a global reference that outlives the hook.
+            // Returns null if the thread cannot attach or the listener has
+            // no such (IJJ)V method.
+            static std::unique_ptr<pressure_hook> start(JavaVM* vm, jobject listener,
+                    char const* method = "onNativeMemoryPressure"){
+                std::unique_ptr<pressure_hook> h{ new pressure_hook{ vm, listener } };
+                std::promise<bool> ready;
+                auto ok = ready.get_future();
+                // The promise moves into the thread: set_value may still be
+                // running when start() returns.
+                h->thread = std::thread{ [p = h.get(), method, ready = std::move(ready)]() mutable {
+                    JNIEnv* e = nullptr;
+                    if(p->vm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&e), nullptr) != JNI_OK){
+                        ready.set_value(false);
+                        return;
+                    }
+                    jclass c = e->GetObjectClass(p->listener);
+                    p->on_pressure = e->GetMethodID(c, method, "(IJJ)V");
+                    e->DeleteLocalRef(c);
+                    if(p->on_pressure == NULL){
+                        e->ExceptionClear();
+                        ready.set_value(false);
+                    }
+                    else{
+                        ready.set_value(true);
+                        p->run(e);
+                    }
+                    p->vm->DetachCurrentThread();
+                } };
+                if(!ok.get()){
+                    h->thread.join();
+                    return nullptr;
+                }
+                return h;
+            }
+            pressure_hook(pressure_hook const&) = delete;
+            pressure_hook& operator=(pressure_hook const&) = delete;
+            ~pressure_hook(){
+                auto& s = detail::state::instance();
+                {
+                    std::lock_guard<std::mutex> guard{ s.lock };
+                    stopping = true;
+                }
+                s.wake.notify_all();
+                if(thread.joinable()) thread.join();
+            }
+
+            // Listener calls that threw; the exception is cleared.
+            std::uint64_t failed() const noexcept {
+                return failed_calls.load(std::memory_order_relaxed);
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_MEMORY_HPP
@@ -0,0 +1,277 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_mmap.hpp
+//! \brief   JNI++ memory-mapped files exposed as direct ByteBuffers
+//!
+//! POSIX only. A mapping owns one mmap of a whole file; window() hands Java
+//! a direct ByteBuffer over any part of it, without copying. A ByteBuffer
+//! holds at most 2^31 - 1 bytes, so larger files are read through several
+//! windows.
+//!
+//! A Java object that opens a file owns one handle to the mapping, and
+//! every window buffer owns another, released by a java.lang.ref.Cleaner
+//! once the buffer is unreachable. The file is unmapped when the last of
+//! them is released, so closing the file never invalidates a buffer Java
+//! can still reach:
+//!
+//!   // Java
+//!   final class MappedFile implements AutoCloseable {
+//!       private static final Cleaner CLEANER = Cleaner.create();
+//!       private long handle = open(path);           // files.open(...)
+//!       ByteBuffer window(long offset, int length){ return window(handle, offset, length); }
+//!       public void close(){ release(handle); handle = 0; }
+//!       static final class Release implements Runnable {
+//!           private final long handle;
+//!           Release(long handle){ this.handle = handle; }
+//!           public void run(){ release(handle); }
+//!       }
+//!       private static native void release(long handle);   // files.release(handle)
+//!   }
+//!
+//!   // C++, with global references to CLEANER and MappedFile$Release
+//!   jnipp::mmap::files files{ env, cleaner, release_class };
+//!
+//! The Cleaner is registered on the buffer NewDirectByteBuffer returns;
+//! duplicates, slices and read-only views all keep that buffer reachable.
+//! Windows of a read-only mapping are returned as read-only buffers, since
+//! a write through them would fault.
+//=============================================================================
+#ifndef JNIPP_JNIPP_MMAP_HPP
+#define JNIPP_JNIPP_MMAP_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "jnipp.hpp"
+#include "jnipp_handles.hpp"
+
+namespace jnipp {
+    namespace mmap {
+        enum class mode {
+            read_only,
+            read_write,
+        };
+        enum class advice {
+            normal = MADV_NORMAL,
+            sequential = MADV_SEQUENTIAL,
+            random = MADV_RANDOM,
+            will_need = MADV_WILLNEED,
+            dont_need = MADV_DONTNEED,
+        };
+
+        class mapping {
+        private:
+            void* base = nullptr;
+            std::size_t length = 0;
+            mode access;
+            int err = 0;
+
+        public:
+            // Maps the whole file shared, so writes reach the file. On
+            // failure the mapping is empty and error() holds the errno.
+            mapping(char const* path, mode m = mode::read_only) noexcept
+                : access{ m } {
+                int fd = ::open(path, (m == mode::read_only ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+                if(fd < 0){
+                    err = errno;
+                    return;
+                }
+                struct stat st;
+                if(::fstat(fd, &st) != 0){
+                    err = errno;
+                }
+                else if(st.st_size == 0){
+                    err = EINVAL;
+                }
+                else{
+                    auto prot = m == mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+                    void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), prot, MAP_SHARED, fd, 0);
+                    if(p == MAP_FAILED){
+                        err = errno;
+                    }
+                    else{
+                        base = p;
+                        length = static_cast<std::size_t>(st.st_size);
+                        JNIPP_MEMORY_ACQUIRE(mapped, length);
+                    }
+                }
+                ::close(fd);
+            }
+            mapping(mapping const&) = delete;
+            mapping& operator=(mapping const&) = delete;
+            ~mapping(){
+                if(base != nullptr){
+                    ::munmap(base, length);
+                    JNIPP_MEMORY_RELEASE(mapped, length);
+                }
+            }
+
+            explicit operator bool() const noexcept {
+                return base != nullptr;
+            }
+            int error() const noexcept {
+                return err;
+            }
+            void* data() const noexcept {
+                return base;
+            }
+            std::size_t size() const noexcept {
+                return length;
+            }
+            mode get_mode() const noexcept {
+                return access;
+            }
+
+            // madvise over [offset, offset + n), widened to whole pages;
+            // n == 0 means up to the end.
+            bool advise(advice a, std::size_t offset = 0, std::size_t n = 0) noexcept {
+                if(base == nullptr || offset >= length) return false;
+                if(n == 0 || n > length - offset) n = length - offset;
+                auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                auto begin = offset - offset % page;
+                return ::madvise(static_cast<char*>(base) + begin, n + (offset - begin), static_cast<int>(a)) == 0;
+            }
+            // Flushes writes of a read-write mapping to the file.
+            bool sync() noexcept {
+                return base != nullptr && ::msync(base, length, MS_SYNC) == 0;
+            }
+
+            // Local reference to a direct ByteBuffer over [offset, offset + n).
+            // The buffer does not keep the mapping alive; hand Java windows
+            // through files instead.
+            jni_expected<jobject> window(JNIEnv* env, std::size_t offset, std::size_t n) const {
+                auto b = buffer(env, offset, n);
+                if(!b) return b;
+                return as_read_only(env, *b);
+            }
+
+        private:
+            friend class files;
+
+            jni_expected<jobject> buffer(JNIEnv* env, std::size_t offset, std::size_t n) const {
+                if(base == nullptr || offset > length || n > length - offset ||
+                   n > static_cast<std::size_t>(std::numeric_limits<jint>::max())){
+                    return jni_raise(env, "Window out of range in mmap::mapping::buffer function.");
+                }
+                jobject b = env->NewDirectByteBuffer(static_cast<char*>(base) + offset, static_cast<jlong>(n));
+                if(b == NULL){
+                    return jni_raise(env, "NewDirectByteBuffer failed in mmap::mapping::buffer function.");
+                }
+                return b;
+            }
+            // A read-only view of b for a read-only mapping; b itself
+            // otherwise. Deletes b when it returns a view.
+            jni_expected<jobject> as_read_only(JNIEnv* env, jobject b) const {
+                if(access == mode::read_write) return b;
+                jclass c = env->GetObjectClass(b);
+                jmethodID read_only = env->GetMethodID(c, "asReadOnlyBuffer", "()Ljava/nio/ByteBuffer;");
+                jobject r = read_only == NULL ? NULL : env->CallObjectMethod(b, read_only);
+                env->DeleteLocalRef(c);
+                env->DeleteLocalRef(b);
+                if(r == NULL){
+                    return jni_raise(env, "asReadOnlyBuffer failed in mmap::mapping::as_read_only function.");
+                }
+                return r;
+            }
+        };
+
+        // Mappings behind jlong handles. Each handle holds one reference;
+        // the file is unmapped when the last is released.
+        class files {
+        private:
+            handles::registry<std::shared_ptr<mapping>> refs;
+            jobject cleaner;
+            jclass action;
+            jmethodID make_action;
+            jmethodID register_action;
+
+        public:
+            // cleaner is a java.lang.ref.Cleaner, action a Runnable class
+            // whose (long) constructor takes the handle its run() passes to
+            // release(). Both must be global references that outlive this.
+            // If a method is missing, the files is empty and the
+            // NoSuchMethodError is left pending.
+            files(JNIEnv* env, jobject cleaner, jclass action) noexcept
+                : cleaner{ cleaner }, action{ action } {
+                make_action = env->GetMethodID(action, "<init>", "(J)V");
+                if(make_action == NULL){
+                    register_action = NULL;
+                    return;
+                }
+                jclass c = env->GetObjectClass(cleaner);
+                register_action = env->GetMethodID(c, "register",
+                    "(Ljava/lang/Object;Ljava/lang/Runnable;)Ljava/lang/ref/Cleaner$Cleanable;");
+                env->DeleteLocalRef(c);
+            }
+            files(files const&) = delete;
+            files& operator=(files const&) = delete;
+
+            explicit operator bool() const noexcept {
+                return make_action != NULL && register_action != NULL;
+            }
+
+            // Handle of the opening Java object, or 0 if the mapping is
+            // empty or no handle is left.
+            jlong open(std::unique_ptr<mapping> m){
+                if(!m || !*m) return 0;
+                return refs.insert(std::unique_ptr<std::shared_ptr<mapping>>{
+                    new std::shared_ptr<mapping>{ std::move(m) } });
+            }
+            // The mapping, or null if the handle was released. As with
+            // handles::registry, the caller must not race the release of
+            // the handle it passes.
+            mapping* get(jlong h) const noexcept {
+                auto ref = refs.get(h);
+                return ref == nullptr ? nullptr : ref->get();
+            }
+            // Drops the handle's reference; a stale handle is ignored, so a
+            // Cleaner running after close() is harmless.
+            void release(jlong h) noexcept {
+                refs.release(h);
+            }
+            // Local reference to a direct ByteBuffer over [offset, offset + n)
+            // of the mapping behind h, keeping it mapped until the buffer and
+            // every view of it are unreachable.
+            jni_expected<jobject> window(JNIEnv* env, jlong h, std::size_t offset, std::size_t n){
+                auto ref = refs.get(h);
+                if(ref == nullptr){
+                    return jni_raise(env, "Stale handle in mmap::files::window function.");
+                }
+                auto b = (*ref)->buffer(env, offset, n);
+                if(!b) return b;
+                jlong w = refs.insert(std::unique_ptr<std::shared_ptr<mapping>>{ new std::shared_ptr<mapping>{ *ref } });
+                if(w == 0){
+                    env->DeleteLocalRef(*b);
+                    return jni_raise(env, "No handle left in mmap::files::window function.");
+                }
+                jobject a = env->NewObject(action, make_action, w);
+                jobject cleanable = a == NULL ? NULL : env->CallObjectMethod(cleaner, register_action, *b, a);
+                if(cleanable == NULL){
+                    // Not registered, so nothing else releases w.
+                    refs.release(w);
+                    env->DeleteLocalRef(a);
+                    env->DeleteLocalRef(*b);
+                    return jni_raise(env, "Cleaner registration failed in mmap::files::window function.");
+                }
+                env->DeleteLocalRef(cleanable);
+                env->DeleteLocalRef(a);
+                return (*ref)->as_read_only(env, *b);
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_MMAP_HPP
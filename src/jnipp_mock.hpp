@@ -0,0 +1,1041 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_mock.hpp
+//! \brief   JNI++ JVM-free JNIEnv for deterministic tests and benchmarks
+//!
+//! mock::jvm fills a JNINativeInterface_ table whose functions operate on an
+//! in-process object model: classes, methods and fields are declared up
+//! front, Java method bodies are C++ handlers. Every JNI call is counted
+//! and can be recorded in order; lookups can be given an artificial
+//! latency. A jvm instance is single-threaded. A JNI function the mock does
+//! not implement, or a field access a JVM would crash on, aborts the test
+//! with its name.
+//!
+//! No JDK is needed: without one, put src/mock on the include path ahead of
+//! the system headers, and its jni.h stands in for the JDK's. The tests in
+//! test/ build this way.
+//=============================================================================
+#ifndef JNIPP_JNIPP_MOCK_HPP
+#define JNIPP_JNIPP_MOCK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace mock {
+        // Typed variants (CallIntMethod, CallIntMethodV, ...) are counted
+        // under their family.
+        enum class function : std::uint16_t {
+            GetVersion,
+            FindClass,
+            GetMethodID,
+            GetStaticMethodID,
+            GetFieldID,
+            GetStaticFieldID,
+            CallMethod,
+            CallStaticMethod,
+            NewObject,
+            AllocObject,
+            GetField,
+            SetField,
+            GetStaticField,
+            SetStaticField,
+            GetObjectClass,
+            IsInstanceOf,
+            IsSameObject,
+            ExceptionCheck,
+            ExceptionOccurred,
+            ExceptionClear,
+            ExceptionDescribe,
+            Throw,
+            ThrowNew,
+            FatalError,
+            NewGlobalRef,
+            DeleteGlobalRef,
+            NewWeakGlobalRef,
+            DeleteWeakGlobalRef,
+            NewLocalRef,
+            DeleteLocalRef,
+            PushLocalFrame,
+            PopLocalFrame,
+            EnsureLocalCapacity,
+            NewStringUTF,
+            NewString,
+            GetStringLength,
+            GetStringUTFLength,
+            GetStringUTFChars,
+            ReleaseStringUTFChars,
+            NewArray,
+            GetArrayLength,
+            GetArrayRegion,
+            SetArrayRegion,
+            NewObjectArray,
+            GetObjectArrayElement,
+            SetObjectArrayElement,
+            GetPrimitiveArrayCritical,
+            ReleasePrimitiveArrayCritical,
+            RegisterNatives,
+            UnregisterNatives,
+            NewDirectByteBuffer,
+            GetDirectBufferAddress,
+            GetDirectBufferCapacity,
+            GetJavaVM,
+            function_count
+        };
+
+        inline char const* name(function f) noexcept {
+            static char const* const names[] = {
+                    "GetVersion", "FindClass", "GetMethodID", "GetStaticMethodID", "GetFieldID",
+                    "GetStaticFieldID", "CallMethod", "CallStaticMethod", "NewObject", "AllocObject",
+                    "GetField", "SetField", "GetStaticField", "SetStaticField", "GetObjectClass",
+                    "IsInstanceOf", "IsSameObject", "ExceptionCheck", "ExceptionOccurred",
+                    "ExceptionClear", "ExceptionDescribe", "Throw", "ThrowNew", "FatalError",
+                    "NewGlobalRef", "DeleteGlobalRef", "NewWeakGlobalRef", "DeleteWeakGlobalRef",
+                    "NewLocalRef", "DeleteLocalRef", "PushLocalFrame", "PopLocalFrame",
+                    "EnsureLocalCapacity", "NewStringUTF", "NewString", "GetStringLength",
+                    "GetStringUTFLength", "GetStringUTFChars", "ReleaseStringUTFChars", "NewArray",
+                    "GetArrayLength", "GetArrayRegion", "SetArrayRegion", "NewObjectArray",
+                    "GetObjectArrayElement", "SetObjectArrayElement", "GetPrimitiveArrayCritical",
+                    "ReleasePrimitiveArrayCritical", "RegisterNatives", "UnregisterNatives",
+                    "NewDirectByteBuffer", "GetDirectBufferAddress", "GetDirectBufferCapacity",
+                    "GetJavaVM",
+            };
+            static_assert(sizeof(names) / sizeof(names[0]) == static_cast<std::size_t>(function::function_count),
+                "function names out of sync");
+            return names[static_cast<std::size_t>(f)];
+        }
+
+        class jvm;
+        // Body of a mocked Java method. self is the receiver, or the class
+        // for static methods; args follow the method signature.
+        using handler = std::function<jvalue(jvm&, jobject self, jvalue const* args)>;
+
+        namespace detail {
+            struct class_info;
+            struct method_info {
+                class_info* owner;
+                std::string name;
+                std::string signature;
+                bool is_static;
+                handler body;
+                std::uint64_t calls;
+            };
+            struct field_info {
+                class_info* owner;
+                std::string name;
+                std::string signature;
+                bool is_static;
+                jvalue value;                           // static fields only
+            };
+            struct object {
+                enum kind_t { instance, clas, string, array, buffer } kind;
+                class_info* type;
+                class_info* described;                  // kind == clas
+                std::string text;                       // string, throwable message
+                std::vector<unsigned char> data;        // primitive array
+                std::size_t element_size;
+                std::vector<jobject> elements;          // object array
+                void* address;                          // direct buffer
+                jlong capacity;
+                std::map<field_info const*, jvalue> fields;
+            };
+            struct class_info {
+                std::string name;
+                object* self;
+                std::deque<method_info> methods;
+                std::deque<field_info> fields;
+                std::vector<JNINativeMethod> natives;
+            };
+
+            // Names of the JNINativeInterface_ functions after the four
+            // reserved slots, in table order.
+            inline char const* jni_function(std::size_t slot) noexcept {
+                static char const* const names[] = {
+                    "GetVersion", "DefineClass", "FindClass", "FromReflectedMethod", "FromReflectedField",
+                    "ToReflectedMethod", "GetSuperclass", "IsAssignableFrom", "ToReflectedField", "Throw",
+                    "ThrowNew", "ExceptionOccurred", "ExceptionDescribe", "ExceptionClear", "FatalError",
+                    "PushLocalFrame", "PopLocalFrame", "NewGlobalRef", "DeleteGlobalRef", "DeleteLocalRef",
+                    "IsSameObject", "NewLocalRef", "EnsureLocalCapacity", "AllocObject", "NewObject",
+                    "NewObjectV", "NewObjectA", "GetObjectClass", "IsInstanceOf", "GetMethodID",
+                    "CallObjectMethod", "CallObjectMethodV", "CallObjectMethodA", "CallBooleanMethod",
+                    "CallBooleanMethodV", "CallBooleanMethodA", "CallByteMethod", "CallByteMethodV",
+                    "CallByteMethodA", "CallCharMethod", "CallCharMethodV", "CallCharMethodA", "CallShortMethod",
+                    "CallShortMethodV", "CallShortMethodA", "CallIntMethod", "CallIntMethodV", "CallIntMethodA",
+                    "CallLongMethod", "CallLongMethodV", "CallLongMethodA", "CallFloatMethod", "CallFloatMethodV",
+                    "CallFloatMethodA", "CallDoubleMethod", "CallDoubleMethodV", "CallDoubleMethodA",
+                    "CallVoidMethod", "CallVoidMethodV", "CallVoidMethodA", "CallNonvirtualObjectMethod",
+                    "CallNonvirtualObjectMethodV", "CallNonvirtualObjectMethodA", "CallNonvirtualBooleanMethod",
+                    "CallNonvirtualBooleanMethodV", "CallNonvirtualBooleanMethodA", "CallNonvirtualByteMethod",
+                    "CallNonvirtualByteMethodV", "CallNonvirtualByteMethodA", "CallNonvirtualCharMethod",
+                    "CallNonvirtualCharMethodV", "CallNonvirtualCharMethodA", "CallNonvirtualShortMethod",
+                    "CallNonvirtualShortMethodV", "CallNonvirtualShortMethodA", "CallNonvirtualIntMethod",
+                    "CallNonvirtualIntMethodV", "CallNonvirtualIntMethodA", "CallNonvirtualLongMethod",
+                    "CallNonvirtualLongMethodV", "CallNonvirtualLongMethodA", "CallNonvirtualFloatMethod",
+                    "CallNonvirtualFloatMethodV", "CallNonvirtualFloatMethodA", "CallNonvirtualDoubleMethod",
+                    "CallNonvirtualDoubleMethodV", "CallNonvirtualDoubleMethodA", "CallNonvirtualVoidMethod",
+                    "CallNonvirtualVoidMethodV", "CallNonvirtualVoidMethodA", "GetFieldID", "GetObjectField",
+                    "GetBooleanField", "GetByteField", "GetCharField", "GetShortField", "GetIntField",
+                    "GetLongField", "GetFloatField", "GetDoubleField", "SetObjectField", "SetBooleanField",
+                    "SetByteField", "SetCharField", "SetShortField", "SetIntField", "SetLongField",
+                    "SetFloatField", "SetDoubleField", "GetStaticMethodID", "CallStaticObjectMethod",
+                    "CallStaticObjectMethodV", "CallStaticObjectMethodA", "CallStaticBooleanMethod",
+                    "CallStaticBooleanMethodV", "CallStaticBooleanMethodA", "CallStaticByteMethod",
+                    "CallStaticByteMethodV", "CallStaticByteMethodA", "CallStaticCharMethod",
+                    "CallStaticCharMethodV", "CallStaticCharMethodA", "CallStaticShortMethod",
+                    "CallStaticShortMethodV", "CallStaticShortMethodA", "CallStaticIntMethod",
+                    "CallStaticIntMethodV", "CallStaticIntMethodA", "CallStaticLongMethod",
+                    "CallStaticLongMethodV", "CallStaticLongMethodA", "CallStaticFloatMethod",
+                    "CallStaticFloatMethodV", "CallStaticFloatMethodA", "CallStaticDoubleMethod",
+                    "CallStaticDoubleMethodV", "CallStaticDoubleMethodA", "CallStaticVoidMethod",
+                    "CallStaticVoidMethodV", "CallStaticVoidMethodA", "GetStaticFieldID", "GetStaticObjectField",
+                    "GetStaticBooleanField", "GetStaticByteField", "GetStaticCharField", "GetStaticShortField",
+                    "GetStaticIntField", "GetStaticLongField", "GetStaticFloatField", "GetStaticDoubleField",
+                    "SetStaticObjectField", "SetStaticBooleanField", "SetStaticByteField", "SetStaticCharField",
+                    "SetStaticShortField", "SetStaticIntField", "SetStaticLongField", "SetStaticFloatField",
+                    "SetStaticDoubleField", "NewString", "GetStringLength", "GetStringChars",
+                    "ReleaseStringChars", "NewStringUTF", "GetStringUTFLength", "GetStringUTFChars",
+                    "ReleaseStringUTFChars", "GetArrayLength", "NewObjectArray", "GetObjectArrayElement",
+                    "SetObjectArrayElement", "NewBooleanArray", "NewByteArray", "NewCharArray", "NewShortArray",
+                    "NewIntArray", "NewLongArray", "NewFloatArray", "NewDoubleArray", "GetBooleanArrayElements",
+                    "GetByteArrayElements", "GetCharArrayElements", "GetShortArrayElements",
+                    "GetIntArrayElements", "GetLongArrayElements", "GetFloatArrayElements",
+                    "GetDoubleArrayElements", "ReleaseBooleanArrayElements", "ReleaseByteArrayElements",
+                    "ReleaseCharArrayElements", "ReleaseShortArrayElements", "ReleaseIntArrayElements",
+                    "ReleaseLongArrayElements", "ReleaseFloatArrayElements", "ReleaseDoubleArrayElements",
+                    "GetBooleanArrayRegion", "GetByteArrayRegion", "GetCharArrayRegion", "GetShortArrayRegion",
+                    "GetIntArrayRegion", "GetLongArrayRegion", "GetFloatArrayRegion", "GetDoubleArrayRegion",
+                    "SetBooleanArrayRegion", "SetByteArrayRegion", "SetCharArrayRegion", "SetShortArrayRegion",
+                    "SetIntArrayRegion", "SetLongArrayRegion", "SetFloatArrayRegion", "SetDoubleArrayRegion",
+                    "RegisterNatives", "UnregisterNatives", "MonitorEnter", "MonitorExit", "GetJavaVM",
+                    "GetStringRegion", "GetStringUTFRegion", "GetPrimitiveArrayCritical",
+                    "ReleasePrimitiveArrayCritical", "GetStringCritical", "ReleaseStringCritical",
+                    "NewWeakGlobalRef", "DeleteWeakGlobalRef", "ExceptionCheck", "NewDirectByteBuffer",
+                    "GetDirectBufferAddress", "GetDirectBufferCapacity", "GetObjectRefType", "GetModule",
+                    "IsVirtualThread",
+                };
+                return slot < sizeof(names) / sizeof(names[0]) ? names[slot] : "added after JDK 21";
+            }
+
+            // Arguments of a variadic call, decoded with the method signature.
+            inline std::vector<jvalue> decode(std::string const& signature, va_list args){
+                std::vector<jvalue> out;
+                std::size_t i = 1;
+                while(i < signature.size() && signature[i] != ')'){
+                    jvalue v;
+                    std::memset(&v, 0, sizeof(v));
+                    char c = signature[i];
+                    switch(c){
+                    case 'Z': v.z = static_cast<jboolean>(va_arg(args, int)); break;
+                    case 'B': v.b = static_cast<jbyte>(va_arg(args, int)); break;
+                    case 'C': v.c = static_cast<jchar>(va_arg(args, int)); break;
+                    case 'S': v.s = static_cast<jshort>(va_arg(args, int)); break;
+                    case 'I': v.i = va_arg(args, jint); break;
+                    case 'J': v.j = va_arg(args, jlong); break;
+                    case 'F': v.f = static_cast<jfloat>(va_arg(args, double)); break;
+                    case 'D': v.d = va_arg(args, double); break;
+                    default: v.l = va_arg(args, jobject); break;
+                    }
+                    while(signature[i] == '[') ++i;
+                    if(signature[i] == 'L'){
+                        while(signature[i] != ';') ++i;
+                    }
+                    ++i;
+                    out.push_back(v);
+                }
+                return out;
+            }
+        }
+
+        class jvm {
+        private:
+            struct env_type : public JNIEnv {
+                jvm* owner;
+            };
+            struct vm_type : public JavaVM {
+                jvm* owner;
+            };
+
+            static constexpr std::size_t reserved_slots = 4;
+            static constexpr std::size_t function_slots = sizeof(JNINativeInterface_) / sizeof(void*) - reserved_slots;
+
+            JNINativeInterface_ table;
+            JNIInvokeInterface_ invoke_table;
+            env_type e;
+            vm_type v;
+
+            std::deque<detail::object> objects;
+            std::deque<detail::class_info> classes;
+            std::map<std::string, detail::class_info*> class_names;
+            std::map<std::string, detail::object*> strings;
+            detail::object* pending;
+            std::uint64_t counts[static_cast<std::size_t>(function::function_count)];
+            std::vector<function> calls;
+            bool recording;
+            bool out_of_memory;
+            bool refuse_attach;
+            std::chrono::nanoseconds latency;
+            std::int64_t locals;
+            std::int64_t globals;
+            std::vector<std::int64_t> frames;
+
+        public:
+            jvm();
+            jvm(jvm const&) = delete;
+            jvm& operator=(jvm const&) = delete;
+
+            JNIEnv* env() noexcept {
+                return &e;
+            }
+            JavaVM* vm() noexcept {
+                return &v;
+            }
+
+            // Model setup. These do not count as JNI calls.
+            jclass define_class(char const* name){
+                return handle<jclass>(class_named(name)->self);
+            }
+            jmethodID define_method(jclass c, char const* name, char const* signature, handler body = {}){
+                return add_method(c, name, signature, false, std::move(body));
+            }
+            jmethodID define_static_method(jclass c, char const* name, char const* signature, handler body = {}){
+                return add_method(c, name, signature, true, std::move(body));
+            }
+            jfieldID define_field(jclass c, char const* name, char const* signature){
+                return add_field(c, name, signature, false);
+            }
+            jfieldID define_static_field(jclass c, char const* name, char const* signature){
+                return add_field(c, name, signature, true);
+            }
+            jobject new_object(jclass c){
+                return handle<jobject>(make(detail::object::instance, info(c)));
+            }
+            void set_lookup_latency(std::chrono::nanoseconds l) noexcept {
+                latency = l;
+            }
+            void record_sequence(bool on) noexcept {
+                recording = on;
+            }
+            // New primitive arrays fail with OutOfMemoryError while on.
+            void fail_allocations(bool on) noexcept {
+                out_of_memory = on;
+            }
+            // AttachCurrentThread and AttachCurrentThreadAsDaemon return
+            // JNI_ERR while on.
+            void fail_attach(bool on) noexcept {
+                refuse_attach = on;
+            }
+            // Makes a Java exception pending, e.g. from inside a handler.
+            void throw_new(char const* clas, char const* message){
+                auto t = make(detail::object::instance, class_named(clas));
+                t->text = message == NULL ? "" : message;
+                pending = t;
+            }
+
+            // Observation.
+            std::uint64_t count(function f) const noexcept {
+                return counts[static_cast<std::size_t>(f)];
+            }
+            std::uint64_t total() const noexcept {
+                std::uint64_t n = 0;
+                for(auto c : counts) n += c;
+                return n;
+            }
+            std::uint64_t invocations(jmethodID m) const noexcept {
+                return reinterpret_cast<detail::method_info const*>(m)->calls;
+            }
+            std::vector<function> const& sequence() const noexcept {
+                return calls;
+            }
+            std::int64_t local_refs() const noexcept {
+                return locals;
+            }
+            std::int64_t global_refs() const noexcept {
+                return globals;
+            }
+            jthrowable exception() const noexcept {
+                return handle<jthrowable>(pending);
+            }
+            std::string message(jthrowable t) const {
+                return t == NULL ? std::string{} : object_of(t)->text;
+            }
+            std::string const& class_name(jobject o) const {
+                return object_of(o)->type->name;
+            }
+            std::vector<JNINativeMethod> const& natives(jclass c) const {
+                return info(c)->natives;
+            }
+            void reset_counters() noexcept {
+                for(auto& c : counts) c = 0;
+                calls.clear();
+            }
+
+        private:
+            template<typename Handle>
+            static Handle handle(detail::object* o) noexcept {
+                return reinterpret_cast<Handle>(o);
+            }
+            static detail::object* object_of(jobject o) noexcept {
+                return reinterpret_cast<detail::object*>(o);
+            }
+            static detail::class_info* info(jclass c) noexcept {
+                return object_of(c)->described;
+            }
+            static jvm& self(JNIEnv* env) noexcept {
+                return *static_cast<env_type*>(env)->owner;
+            }
+
+            void hit(function f){
+                ++counts[static_cast<std::size_t>(f)];
+                if(recording) calls.push_back(f);
+            }
+            void wait(){
+                if(latency.count() == 0) return;
+                auto until = std::chrono::steady_clock::now() + latency;
+                while(std::chrono::steady_clock::now() < until){
+                }
+            }
+            template<typename Handle>
+            Handle local(Handle h){
+                if(h != NULL) ++locals;
+                return h;
+            }
+            detail::object* make(detail::object::kind_t k, detail::class_info* type){
+                objects.emplace_back();
+                auto& o = objects.back();
+                o.kind = k;
+                o.type = type;
+                o.described = nullptr;
+                o.element_size = 0;
+                o.address = nullptr;
+                o.capacity = 0;
+                return &o;
+            }
+            detail::class_info* class_named(char const* name){
+                auto it = class_names.find(name);
+                if(it != class_names.end()) return it->second;
+                classes.emplace_back();
+                auto& c = classes.back();
+                c.name = name;
+                class_names[c.name] = &c;
+                auto clas = class_names.find("java/lang/Class");
+                c.self = make(detail::object::clas, clas == class_names.end() ? &c : clas->second);
+                c.self->described = &c;
+                return &c;
+            }
+            jmethodID add_method(jclass c, char const* name, char const* signature, bool is_static, handler body){
+                auto k = info(c);
+                k->methods.push_back(detail::method_info{ k, name, signature, is_static, std::move(body), 0 });
+                return reinterpret_cast<jmethodID>(&k->methods.back());
+            }
+            jfieldID add_field(jclass c, char const* name, char const* signature, bool is_static){
+                auto k = info(c);
+                jvalue zero;
+                std::memset(&zero, 0, sizeof(zero));
+                k->fields.push_back(detail::field_info{ k, name, signature, is_static, zero });
+                return reinterpret_cast<jfieldID>(&k->fields.back());
+            }
+            template<typename Id, typename List>
+            Id find_member(List detail::class_info::* list, jclass c, char const* name, char const* signature,
+                    bool is_static, char const* error){
+                wait();
+                if(c != NULL){
+                    for(auto& m : info(c)->*list){
+                        if(m.is_static == is_static && m.name == name && m.signature == signature){
+                            return reinterpret_cast<Id>(&m);
+                        }
+                    }
+                }
+                throw_new(error, name);
+                return NULL;
+            }
+
+            jvalue call(jobject receiver, jmethodID m, jvalue const* args){
+                jvalue r;
+                std::memset(&r, 0, sizeof(r));
+                auto method = reinterpret_cast<detail::method_info*>(m);
+                ++method->calls;
+                if(method->body) r = method->body(*this, receiver, args);
+                char returns = method->signature[method->signature.find(')') + 1];
+                if((returns == 'L' || returns == '[') && r.l != NULL) ++locals;
+                return r;
+            }
+            jvalue call(jobject receiver, jmethodID m, va_list args){
+                auto decoded = detail::decode(reinterpret_cast<detail::method_info*>(m)->signature, args);
+                return call(receiver, m, decoded.data());
+            }
+            // A real JVM crashes on these, so the mock stops the test.
+            [[noreturn]] static void fail(char const* what, char const* detail){
+                std::fprintf(stderr, "jnipp::mock: %s%s\n", what, detail);
+                std::abort();
+            }
+            jvalue& field(jobject o, jfieldID f){
+                auto fi = reinterpret_cast<detail::field_info*>(f);
+                if(fi->is_static) fail("instance access to static field ", fi->name.c_str());
+                if(o == NULL) fail("null object reading or writing field ", fi->name.c_str());
+                auto it = object_of(o)->fields.find(fi);
+                if(it == object_of(o)->fields.end()){
+                    jvalue zero;
+                    std::memset(&zero, 0, sizeof(zero));
+                    it = object_of(o)->fields.emplace(fi, zero).first;
+                }
+                return it->second;
+            }
+            // Every JNI function the mock does not implement stops the test
+            // with its name instead of calling through a null pointer.
+            template<std::size_t Slot>
+            static void JNICALL trap(JNIEnv*){
+                fail("unimplemented JNI function ", detail::jni_function(Slot));
+            }
+            template<std::size_t... Slot>
+            void install_traps(std::index_sequence<Slot...>) noexcept {
+                using trap_type = void (JNICALL*)(JNIEnv*);
+                static_assert(sizeof(trap_type) == sizeof(void*), "JNI table slots must hold function pointers.");
+                trap_type const traps[] = { &trap<Slot>... };
+                std::memcpy(reinterpret_cast<char*>(&table) + reserved_slots * sizeof(void*), traps, sizeof(traps));
+            }
+            jvalue& static_field(jfieldID f){
+                auto fi = reinterpret_cast<detail::field_info*>(f);
+                if(!fi->is_static) fail("static access to instance field ", fi->name.c_str());
+                return fi->value;
+            }
+            bool in_bounds(jarray a, jsize start, jsize len){
+                auto o = object_of(a);
+                auto size = o->element_size == 0 ? o->elements.size() : o->data.size() / o->element_size;
+                if(start < 0 || len < 0 || static_cast<std::size_t>(start) + static_cast<std::size_t>(len) > size){
+                    throw_new("java/lang/ArrayIndexOutOfBoundsException", "");
+                    return false;
+                }
+                return true;
+            }
+
+            static jint JNICALL GetVersion(JNIEnv* env){
+                self(env).hit(function::GetVersion);
+                return JNI_VERSION_1_6;
+            }
+            static jclass JNICALL FindClass(JNIEnv* env, char const* name){
+                auto& s = self(env);
+                s.hit(function::FindClass);
+                s.wait();
+                auto it = s.class_names.find(name);
+                if(it == s.class_names.end()){
+                    s.throw_new("java/lang/NoClassDefFoundError", name);
+                    return NULL;
+                }
+                return s.local(handle<jclass>(it->second->self));
+            }
+            static jmethodID JNICALL GetMethodID(JNIEnv* env, jclass c, char const* name, char const* sig){
+                auto& s = self(env);
+                s.hit(function::GetMethodID);
+                return s.find_member<jmethodID>(&detail::class_info::methods, c, name, sig, false, "java/lang/NoSuchMethodError");
+            }
+            static jmethodID JNICALL GetStaticMethodID(JNIEnv* env, jclass c, char const* name, char const* sig){
+                auto& s = self(env);
+                s.hit(function::GetStaticMethodID);
+                return s.find_member<jmethodID>(&detail::class_info::methods, c, name, sig, true, "java/lang/NoSuchMethodError");
+            }
+            static jfieldID JNICALL GetFieldID(JNIEnv* env, jclass c, char const* name, char const* sig){
+                auto& s = self(env);
+                s.hit(function::GetFieldID);
+                return s.find_member<jfieldID>(&detail::class_info::fields, c, name, sig, false, "java/lang/NoSuchFieldError");
+            }
+            static jfieldID JNICALL GetStaticFieldID(JNIEnv* env, jclass c, char const* name, char const* sig){
+                auto& s = self(env);
+                s.hit(function::GetStaticFieldID);
+                return s.find_member<jfieldID>(&detail::class_info::fields, c, name, sig, true, "java/lang/NoSuchFieldError");
+            }
+
+#define JNIPP_MOCK_CALL(name, type, member) \
+            static type JNICALL Call##name##Method(JNIEnv* env, jobject o, jmethodID m, ...){ \
+                va_list args; va_start(args, m); \
+                self(env).hit(function::CallMethod); \
+                jvalue r = self(env).call(o, m, args); \
+                va_end(args); return static_cast<type>(r.member); } \
+            static type JNICALL Call##name##MethodV(JNIEnv* env, jobject o, jmethodID m, va_list args){ \
+                self(env).hit(function::CallMethod); \
+                return static_cast<type>(self(env).call(o, m, args).member); } \
+            static type JNICALL Call##name##MethodA(JNIEnv* env, jobject o, jmethodID m, jvalue const* args){ \
+                self(env).hit(function::CallMethod); \
+                return static_cast<type>(self(env).call(o, m, args).member); } \
+            static type JNICALL CallStatic##name##Method(JNIEnv* env, jclass c, jmethodID m, ...){ \
+                va_list args; va_start(args, m); \
+                self(env).hit(function::CallStaticMethod); \
+                jvalue r = self(env).call(c, m, args); \
+                va_end(args); return static_cast<type>(r.member); } \
+            static type JNICALL CallStatic##name##MethodV(JNIEnv* env, jclass c, jmethodID m, va_list args){ \
+                self(env).hit(function::CallStaticMethod); \
+                return static_cast<type>(self(env).call(c, m, args).member); } \
+            static type JNICALL CallStatic##name##MethodA(JNIEnv* env, jclass c, jmethodID m, jvalue const* args){ \
+                self(env).hit(function::CallStaticMethod); \
+                return static_cast<type>(self(env).call(c, m, args).member); } \
+            static type JNICALL Get##name##Field(JNIEnv* env, jobject o, jfieldID f){ \
+                self(env).hit(function::GetField); \
+                return static_cast<type>(self(env).field(o, f).member); } \
+            static void JNICALL Set##name##Field(JNIEnv* env, jobject o, jfieldID f, type value){ \
+                self(env).hit(function::SetField); \
+                self(env).field(o, f).member = value; } \
+            static type JNICALL GetStatic##name##Field(JNIEnv* env, jclass, jfieldID f){ \
+                self(env).hit(function::GetStaticField); \
+                return static_cast<type>(self(env).static_field(f).member); } \
+            static void JNICALL SetStatic##name##Field(JNIEnv* env, jclass, jfieldID f, type value){ \
+                self(env).hit(function::SetStaticField); \
+                self(env).static_field(f).member = value; }
+            JNIPP_MOCK_CALL(Object, jobject, l)
+            JNIPP_MOCK_CALL(Boolean, jboolean, z)
+            JNIPP_MOCK_CALL(Byte, jbyte, b)
+            JNIPP_MOCK_CALL(Char, jchar, c)
+            JNIPP_MOCK_CALL(Short, jshort, s)
+            JNIPP_MOCK_CALL(Int, jint, i)
+            JNIPP_MOCK_CALL(Long, jlong, j)
+            JNIPP_MOCK_CALL(Float, jfloat, f)
+            JNIPP_MOCK_CALL(Double, jdouble, d)
+#undef JNIPP_MOCK_CALL
+            static void JNICALL CallVoidMethod(JNIEnv* env, jobject o, jmethodID m, ...){
+                va_list args;
+                va_start(args, m);
+                self(env).hit(function::CallMethod);
+                self(env).call(o, m, args);
+                va_end(args);
+            }
+            static void JNICALL CallVoidMethodV(JNIEnv* env, jobject o, jmethodID m, va_list args){
+                self(env).hit(function::CallMethod);
+                self(env).call(o, m, args);
+            }
+            static void JNICALL CallVoidMethodA(JNIEnv* env, jobject o, jmethodID m, jvalue const* args){
+                self(env).hit(function::CallMethod);
+                self(env).call(o, m, args);
+            }
+            static void JNICALL CallStaticVoidMethod(JNIEnv* env, jclass c, jmethodID m, ...){
+                va_list args;
+                va_start(args, m);
+                self(env).hit(function::CallStaticMethod);
+                self(env).call(c, m, args);
+                va_end(args);
+            }
+            static void JNICALL CallStaticVoidMethodV(JNIEnv* env, jclass c, jmethodID m, va_list args){
+                self(env).hit(function::CallStaticMethod);
+                self(env).call(c, m, args);
+            }
+            static void JNICALL CallStaticVoidMethodA(JNIEnv* env, jclass c, jmethodID m, jvalue const* args){
+                self(env).hit(function::CallStaticMethod);
+                self(env).call(c, m, args);
+            }
+
+            static jobject construct(jvm& s, jclass c, jmethodID m, jvalue const* args){
+                auto o = handle<jobject>(s.make(detail::object::instance, info(c)));
+                s.call(o, m, args);
+                return s.local(o);
+            }
+            static jobject JNICALL NewObject(JNIEnv* env, jclass c, jmethodID m, ...){
+                va_list args;
+                va_start(args, m);
+                auto& s = self(env);
+                s.hit(function::NewObject);
+                auto decoded = detail::decode(reinterpret_cast<detail::method_info*>(m)->signature, args);
+                va_end(args);
+                return construct(s, c, m, decoded.data());
+            }
+            static jobject JNICALL NewObjectV(JNIEnv* env, jclass c, jmethodID m, va_list args){
+                auto& s = self(env);
+                s.hit(function::NewObject);
+                auto decoded = detail::decode(reinterpret_cast<detail::method_info*>(m)->signature, args);
+                return construct(s, c, m, decoded.data());
+            }
+            static jobject JNICALL NewObjectA(JNIEnv* env, jclass c, jmethodID m, jvalue const* args){
+                auto& s = self(env);
+                s.hit(function::NewObject);
+                return construct(s, c, m, args);
+            }
+            static jobject JNICALL AllocObject(JNIEnv* env, jclass c){
+                auto& s = self(env);
+                s.hit(function::AllocObject);
+                return s.local(handle<jobject>(s.make(detail::object::instance, info(c))));
+            }
+            static jclass JNICALL GetObjectClass(JNIEnv* env, jobject o){
+                auto& s = self(env);
+                s.hit(function::GetObjectClass);
+                return s.local(handle<jclass>(object_of(o)->type->self));
+            }
+            static jboolean JNICALL IsInstanceOf(JNIEnv* env, jobject o, jclass c){
+                self(env).hit(function::IsInstanceOf);
+                return o == NULL || object_of(o)->type == info(c) ? JNI_TRUE : JNI_FALSE;
+            }
+            static jboolean JNICALL IsSameObject(JNIEnv* env, jobject a, jobject b){
+                self(env).hit(function::IsSameObject);
+                return a == b ? JNI_TRUE : JNI_FALSE;
+            }
+
+            static jboolean JNICALL ExceptionCheck(JNIEnv* env){
+                self(env).hit(function::ExceptionCheck);
+                return self(env).pending != nullptr ? JNI_TRUE : JNI_FALSE;
+            }
+            static jthrowable JNICALL ExceptionOccurred(JNIEnv* env){
+                auto& s = self(env);
+                s.hit(function::ExceptionOccurred);
+                return s.local(handle<jthrowable>(s.pending));
+            }
+            static void JNICALL ExceptionClear(JNIEnv* env){
+                self(env).hit(function::ExceptionClear);
+                self(env).pending = nullptr;
+            }
+            static void JNICALL ExceptionDescribe(JNIEnv* env){
+                self(env).hit(function::ExceptionDescribe);
+            }
+            static jint JNICALL Throw(JNIEnv* env, jthrowable t){
+                self(env).hit(function::Throw);
+                self(env).pending = object_of(t);
+                return JNI_OK;
+            }
+            static jint JNICALL ThrowNew(JNIEnv* env, jclass c, char const* message){
+                auto& s = self(env);
+                s.hit(function::ThrowNew);
+                auto t = s.make(detail::object::instance, info(c));
+                t->text = message == NULL ? "" : message;
+                s.pending = t;
+                return JNI_OK;
+            }
+            static void JNICALL FatalError(JNIEnv* env, char const* message){
+                self(env).hit(function::FatalError);
+                self(env).throw_new("java/lang/Error", message);
+            }
+
+            static jobject JNICALL NewGlobalRef(JNIEnv* env, jobject o){
+                self(env).hit(function::NewGlobalRef);
+                if(o != NULL) ++self(env).globals;
+                return o;
+            }
+            static void JNICALL DeleteGlobalRef(JNIEnv* env, jobject o){
+                self(env).hit(function::DeleteGlobalRef);
+                if(o != NULL) --self(env).globals;
+            }
+            static jweak JNICALL NewWeakGlobalRef(JNIEnv* env, jobject o){
+                self(env).hit(function::NewWeakGlobalRef);
+                return o;
+            }
+            static void JNICALL DeleteWeakGlobalRef(JNIEnv* env, jweak){
+                self(env).hit(function::DeleteWeakGlobalRef);
+            }
+            static jobject JNICALL NewLocalRef(JNIEnv* env, jobject o){
+                self(env).hit(function::NewLocalRef);
+                return self(env).local(o);
+            }
+            static void JNICALL DeleteLocalRef(JNIEnv* env, jobject o){
+                self(env).hit(function::DeleteLocalRef);
+                if(o != NULL) --self(env).locals;
+            }
+            static jint JNICALL PushLocalFrame(JNIEnv* env, jint){
+                auto& s = self(env);
+                s.hit(function::PushLocalFrame);
+                s.frames.push_back(s.locals);
+                return JNI_OK;
+            }
+            static jobject JNICALL PopLocalFrame(JNIEnv* env, jobject result){
+                auto& s = self(env);
+                s.hit(function::PopLocalFrame);
+                if(!s.frames.empty()){
+                    s.locals = s.frames.back();
+                    s.frames.pop_back();
+                }
+                return s.local(result);
+            }
+            static jint JNICALL EnsureLocalCapacity(JNIEnv* env, jint){
+                self(env).hit(function::EnsureLocalCapacity);
+                return JNI_OK;
+            }
+
+            static ::jstring JNICALL NewStringUTF(JNIEnv* env, char const* utf){
+                auto& s = self(env);
+                s.hit(function::NewStringUTF);
+                auto o = s.make(detail::object::string, s.class_named("java/lang/String"));
+                o->text = utf;
+                return s.local(handle<::jstring>(o));
+            }
+            static ::jstring JNICALL NewString(JNIEnv* env, jchar const* chars, jsize len){
+                auto& s = self(env);
+                s.hit(function::NewString);
+                auto o = s.make(detail::object::string, s.class_named("java/lang/String"));
+                for(jsize i = 0; i < len; ++i){
+                    o->text += static_cast<char>(chars[i]);
+                }
+                return s.local(handle<::jstring>(o));
+            }
+            static jsize JNICALL GetStringLength(JNIEnv* env, ::jstring str){
+                self(env).hit(function::GetStringLength);
+                return static_cast<jsize>(object_of(str)->text.size());
+            }
+            static jsize JNICALL GetStringUTFLength(JNIEnv* env, ::jstring str){
+                self(env).hit(function::GetStringUTFLength);
+                return static_cast<jsize>(object_of(str)->text.size());
+            }
+            static char const* JNICALL GetStringUTFChars(JNIEnv* env, ::jstring str, jboolean* is_copy){
+                self(env).hit(function::GetStringUTFChars);
+                if(is_copy != NULL) *is_copy = JNI_FALSE;
+                return object_of(str)->text.c_str();
+            }
+            static void JNICALL ReleaseStringUTFChars(JNIEnv* env, ::jstring, char const*){
+                self(env).hit(function::ReleaseStringUTFChars);
+            }
+
+            static jsize JNICALL GetArrayLength(JNIEnv* env, jarray a){
+                self(env).hit(function::GetArrayLength);
+                auto o = object_of(a);
+                return static_cast<jsize>(o->element_size == 0 ? o->elements.size() : o->data.size() / o->element_size);
+            }
+#define JNIPP_MOCK_ARRAY(name, type, sig) \
+            static type##Array JNICALL New##name##Array(JNIEnv* env, jsize len){ \
+                auto& s = self(env); \
+                s.hit(function::NewArray); \
+                if(s.out_of_memory){ \
+                    s.throw_new("java/lang/OutOfMemoryError", "Java heap space"); \
+                    return NULL; \
+                } \
+                auto o = s.make(detail::object::array, s.class_named("[" sig)); \
+                o->element_size = sizeof(type); \
+                o->data.assign(static_cast<std::size_t>(len) * sizeof(type), 0); \
+                return s.local(handle<type##Array>(o)); } \
+            static void JNICALL Get##name##ArrayRegion(JNIEnv* env, type##Array a, jsize start, jsize len, type* buf){ \
+                self(env).hit(function::GetArrayRegion); \
+                if(!self(env).in_bounds(a, start, len)) return; \
+                std::memcpy(buf, object_of(a)->data.data() + start * sizeof(type), len * sizeof(type)); } \
+            static void JNICALL Set##name##ArrayRegion(JNIEnv* env, type##Array a, jsize start, jsize len, type const* buf){ \
+                self(env).hit(function::SetArrayRegion); \
+                if(!self(env).in_bounds(a, start, len)) return; \
+                std::memcpy(object_of(a)->data.data() + start * sizeof(type), buf, len * sizeof(type)); }
+            JNIPP_MOCK_ARRAY(Boolean, jboolean, "Z")
+            JNIPP_MOCK_ARRAY(Byte, jbyte, "B")
+            JNIPP_MOCK_ARRAY(Char, jchar, "C")
+            JNIPP_MOCK_ARRAY(Short, jshort, "S")
+            JNIPP_MOCK_ARRAY(Int, jint, "I")
+            JNIPP_MOCK_ARRAY(Long, jlong, "J")
+            JNIPP_MOCK_ARRAY(Float, jfloat, "F")
+            JNIPP_MOCK_ARRAY(Double, jdouble, "D")
+#undef JNIPP_MOCK_ARRAY
+            static jobjectArray JNICALL NewObjectArray(JNIEnv* env, jsize len, jclass c, jobject init){
+                auto& s = self(env);
+                s.hit(function::NewObjectArray);
+                auto o = s.make(detail::object::array, s.class_named(("[L" + info(c)->name + ";").c_str()));
+                o->elements.assign(static_cast<std::size_t>(len), init);
+                return s.local(handle<jobjectArray>(o));
+            }
+            static jobject JNICALL GetObjectArrayElement(JNIEnv* env, jobjectArray a, jsize i){
+                auto& s = self(env);
+                s.hit(function::GetObjectArrayElement);
+                if(!s.in_bounds(a, i, 1)) return NULL;
+                return s.local(object_of(a)->elements[static_cast<std::size_t>(i)]);
+            }
+            static void JNICALL SetObjectArrayElement(JNIEnv* env, jobjectArray a, jsize i, jobject value){
+                auto& s = self(env);
+                s.hit(function::SetObjectArrayElement);
+                if(!s.in_bounds(a, i, 1)) return;
+                object_of(a)->elements[static_cast<std::size_t>(i)] = value;
+            }
+            static void* JNICALL GetPrimitiveArrayCritical(JNIEnv* env, jarray a, jboolean* is_copy){
+                self(env).hit(function::GetPrimitiveArrayCritical);
+                if(is_copy != NULL) *is_copy = JNI_FALSE;
+                return object_of(a)->data.data();
+            }
+            static void JNICALL ReleasePrimitiveArrayCritical(JNIEnv* env, jarray, void*, jint){
+                self(env).hit(function::ReleasePrimitiveArrayCritical);
+            }
+
+            static jint JNICALL RegisterNatives(JNIEnv* env, jclass c, JNINativeMethod const* methods, jint n){
+                self(env).hit(function::RegisterNatives);
+                info(c)->natives.insert(info(c)->natives.end(), methods, methods + n);
+                return JNI_OK;
+            }
+            static jint JNICALL UnregisterNatives(JNIEnv* env, jclass c){
+                self(env).hit(function::UnregisterNatives);
+                info(c)->natives.clear();
+                return JNI_OK;
+            }
+            static jobject JNICALL NewDirectByteBuffer(JNIEnv* env, void* address, jlong capacity){
+                auto& s = self(env);
+                s.hit(function::NewDirectByteBuffer);
+                auto o = s.make(detail::object::buffer, s.class_named("java/nio/DirectByteBuffer"));
+                o->address = address;
+                o->capacity = capacity;
+                return s.local(handle<jobject>(o));
+            }
+            static void* JNICALL GetDirectBufferAddress(JNIEnv* env, jobject b){
+                self(env).hit(function::GetDirectBufferAddress);
+                return object_of(b)->kind == detail::object::buffer ? object_of(b)->address : NULL;
+            }
+            static jlong JNICALL GetDirectBufferCapacity(JNIEnv* env, jobject b){
+                self(env).hit(function::GetDirectBufferCapacity);
+                return object_of(b)->kind == detail::object::buffer ? object_of(b)->capacity : -1;
+            }
+            static jint JNICALL GetJavaVM(JNIEnv* env, JavaVM** vm){
+                self(env).hit(function::GetJavaVM);
+                *vm = &self(env).v;
+                return JNI_OK;
+            }
+
+            static jvm& owner(JavaVM* vm) noexcept {
+                return *static_cast<vm_type*>(vm)->owner;
+            }
+            static jint JNICALL DestroyJavaVM(JavaVM*){
+                return JNI_OK;
+            }
+            static jint JNICALL AttachCurrentThread(JavaVM* vm, void** penv, void*){
+                if(owner(vm).refuse_attach) return JNI_ERR;
+                *penv = owner(vm).env();
+                return JNI_OK;
+            }
+            static jint JNICALL DetachCurrentThread(JavaVM*){
+                return JNI_OK;
+            }
+            static jint JNICALL GetEnv(JavaVM* vm, void** penv, jint){
+                *penv = owner(vm).env();
+                return JNI_OK;
+            }
+        };
+
+        inline jvm::jvm()
+            : pending{ nullptr }, counts{}, recording{ false }, out_of_memory{ false }, refuse_attach{ false }, latency{ 0 }, locals{ 0 }, globals{ 0 } {
+            std::memset(&table, 0, sizeof(table));
+            install_traps(std::make_index_sequence<function_slots>{});
+            table.GetVersion = &GetVersion;
+            table.FindClass = &FindClass;
+            table.GetMethodID = &GetMethodID;
+            table.GetStaticMethodID = &GetStaticMethodID;
+            table.GetFieldID = &GetFieldID;
+            table.GetStaticFieldID = &GetStaticFieldID;
+#define JNIPP_MOCK_SET(name) \
+            table.Call##name##Method = &Call##name##Method; \
+            table.Call##name##MethodV = &Call##name##MethodV; \
+            table.Call##name##MethodA = &Call##name##MethodA; \
+            table.CallStatic##name##Method = &CallStatic##name##Method; \
+            table.CallStatic##name##MethodV = &CallStatic##name##MethodV; \
+            table.CallStatic##name##MethodA = &CallStatic##name##MethodA;
+#define JNIPP_MOCK_SET_FIELD(name) \
+            table.Get##name##Field = &Get##name##Field; \
+            table.Set##name##Field = &Set##name##Field; \
+            table.GetStatic##name##Field = &GetStatic##name##Field; \
+            table.SetStatic##name##Field = &SetStatic##name##Field;
+#define JNIPP_MOCK_SET_ARRAY(name) \
+            table.New##name##Array = &New##name##Array; \
+            table.Get##name##ArrayRegion = &Get##name##ArrayRegion; \
+            table.Set##name##ArrayRegion = &Set##name##ArrayRegion;
+            JNIPP_MOCK_SET(Void)
+            JNIPP_MOCK_SET(Object) JNIPP_MOCK_SET_FIELD(Object)
+            JNIPP_MOCK_SET(Boolean) JNIPP_MOCK_SET_FIELD(Boolean) JNIPP_MOCK_SET_ARRAY(Boolean)
+            JNIPP_MOCK_SET(Byte) JNIPP_MOCK_SET_FIELD(Byte) JNIPP_MOCK_SET_ARRAY(Byte)
+            JNIPP_MOCK_SET(Char) JNIPP_MOCK_SET_FIELD(Char) JNIPP_MOCK_SET_ARRAY(Char)
+            JNIPP_MOCK_SET(Short) JNIPP_MOCK_SET_FIELD(Short) JNIPP_MOCK_SET_ARRAY(Short)
+            JNIPP_MOCK_SET(Int) JNIPP_MOCK_SET_FIELD(Int) JNIPP_MOCK_SET_ARRAY(Int)
+            JNIPP_MOCK_SET(Long) JNIPP_MOCK_SET_FIELD(Long) JNIPP_MOCK_SET_ARRAY(Long)
+            JNIPP_MOCK_SET(Float) JNIPP_MOCK_SET_FIELD(Float) JNIPP_MOCK_SET_ARRAY(Float)
+            JNIPP_MOCK_SET(Double) JNIPP_MOCK_SET_FIELD(Double) JNIPP_MOCK_SET_ARRAY(Double)
+#undef JNIPP_MOCK_SET_ARRAY
+#undef JNIPP_MOCK_SET_FIELD
+#undef JNIPP_MOCK_SET
+            table.NewObject = &NewObject;
+            table.NewObjectV = &NewObjectV;
+            table.NewObjectA = &NewObjectA;
+            table.AllocObject = &AllocObject;
+            table.GetObjectClass = &GetObjectClass;
+            table.IsInstanceOf = &IsInstanceOf;
+            table.IsSameObject = &IsSameObject;
+            table.ExceptionCheck = &ExceptionCheck;
+            table.ExceptionOccurred = &ExceptionOccurred;
+            table.ExceptionClear = &ExceptionClear;
+            table.ExceptionDescribe = &ExceptionDescribe;
+            table.Throw = &Throw;
+            table.ThrowNew = &ThrowNew;
+            table.FatalError = &FatalError;
+            table.NewGlobalRef = &NewGlobalRef;
+            table.DeleteGlobalRef = &DeleteGlobalRef;
+            table.NewWeakGlobalRef = &NewWeakGlobalRef;
+            table.DeleteWeakGlobalRef = &DeleteWeakGlobalRef;
+            table.NewLocalRef = &NewLocalRef;
+            table.DeleteLocalRef = &DeleteLocalRef;
+            table.PushLocalFrame = &PushLocalFrame;
+            table.PopLocalFrame = &PopLocalFrame;
+            table.EnsureLocalCapacity = &EnsureLocalCapacity;
+            table.NewStringUTF = &NewStringUTF;
+            table.NewString = &NewString;
+            table.GetStringLength = &GetStringLength;
+            table.GetStringUTFLength = &GetStringUTFLength;
+            table.GetStringUTFChars = &GetStringUTFChars;
+            table.ReleaseStringUTFChars = &ReleaseStringUTFChars;
+            table.GetArrayLength = &GetArrayLength;
+            table.NewObjectArray = &NewObjectArray;
+            table.GetObjectArrayElement = &GetObjectArrayElement;
+            table.SetObjectArrayElement = &SetObjectArrayElement;
+            table.GetPrimitiveArrayCritical = &GetPrimitiveArrayCritical;
+            table.ReleasePrimitiveArrayCritical = &ReleasePrimitiveArrayCritical;
+            table.RegisterNatives = &RegisterNatives;
+            table.UnregisterNatives = &UnregisterNatives;
+            table.NewDirectByteBuffer = &NewDirectByteBuffer;
+            table.GetDirectBufferAddress = &GetDirectBufferAddress;
+            table.GetDirectBufferCapacity = &GetDirectBufferCapacity;
+            table.GetJavaVM = &GetJavaVM;
+
+            std::memset(&invoke_table, 0, sizeof(invoke_table));
+            invoke_table.DestroyJavaVM = &DestroyJavaVM;
+            invoke_table.AttachCurrentThread = &AttachCurrentThread;
+            invoke_table.DetachCurrentThread = &DetachCurrentThread;
+            invoke_table.GetEnv = &GetEnv;
+            invoke_table.AttachCurrentThreadAsDaemon = &AttachCurrentThread;
+
+            e.functions = &table;
+            e.owner = this;
+            v.functions = &invoke_table;
+            v.owner = this;
+
+            static char const* const builtin[] = {
+                "java/lang/Class",
+                "java/lang/Object",
+                "java/lang/String",
+                "java/lang/Throwable",
+                "java/lang/Error",
+                "java/lang/RuntimeException",
+                "java/lang/IllegalArgumentException",
+                "java/lang/IllegalStateException",
+                "java/lang/IndexOutOfBoundsException",
+                "java/lang/ArrayIndexOutOfBoundsException",
+                "java/lang/NullPointerException",
+                "java/lang/OutOfMemoryError",
+                "java/lang/NoClassDefFoundError",
+                "java/lang/NoSuchMethodError",
+                "java/lang/NoSuchFieldError",
+            };
+            for(auto name : builtin){
+                class_named(name);
+            }
+            // Throwable.toString(), which jni_error::describe() falls back on.
+            // Methods are not inherited here, but the call dispatches on the
+            // method alone, so every throwable answers it.
+            add_method(handle<jclass>(class_named("java/lang/Throwable")->self), "toString", "()Ljava/lang/String;", false,
+                [](jvm& s, jobject self, jvalue const*){
+                    auto t = object_of(self);
+                    auto o = s.make(detail::object::string, s.class_named("java/lang/String"));
+                    o->text = t->type->name;
+                    std::replace(o->text.begin(), o->text.end(), '/', '.');
+                    if(!t->text.empty()) o->text += ": " + t->text;
+                    jvalue r;
+                    r.l = handle<jobject>(o);
+                    return r;
+                });
+        }
+    }
+}
+#endif // JNIPP_JNIPP_MOCK_HPP
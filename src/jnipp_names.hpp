@@ -0,0 +1,69 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_names.hpp
+//! \brief   JNI++ interned class and member names
+//!
+//! Diagnostics and warmup keep names of looked-up classes and members;
+//! interning gives them a stable address regardless of the caller's string,
+//! so equal names compare equal by pointer.
+//=============================================================================
+#ifndef JNIPP_JNIPP_NAMES_HPP
+#define JNIPP_JNIPP_NAMES_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace jnipp {
+    namespace names {
+        namespace detail {
+            struct table {
+                std::mutex lock;
+                // Nodes never move, so c_str() stays valid across rehashes.
+                std::unordered_set<std::string> strings;
+
+                static table& instance(){
+                    static table t;
+                    return t;
+                }
+            };
+
+            // Per-thread, direct-mapped memo of interned strings, so that a
+            // thread looking up the same names again takes no lock.
+            struct memo {
+                static constexpr std::size_t size = 256;
+                char const* slots[size] = {};
+
+                static char const*& slot(char const* s) noexcept {
+                    static thread_local memo m;
+                    std::size_t h = 2166136261u;
+                    for(; *s != '\0'; ++s){
+                        h = (h ^ static_cast<unsigned char>(*s)) * 16777619u;
+                    }
+                    return m.slots[h % size];
+                }
+            };
+        }
+
+        // Returns a copy of s that lives until exit. Called per lookup,
+        // never per call.
+        inline char const* intern(char const* s){
+            if(s == nullptr) return "";
+            auto& slot = detail::memo::slot(s);
+            if(slot != nullptr && std::strcmp(slot, s) == 0) return slot;
+            auto& t = detail::table::instance();
+            std::lock_guard<std::mutex> guard{ t.lock };
+            slot = t.strings.emplace(s).first->c_str();
+            return slot;
+        }
+    }
+}
+#endif // JNIPP_JNIPP_NAMES_HPP
@@ -0,0 +1,172 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_pojo.hpp
+//! \brief   JNI++ field-by-field decoding and encoding of Java value objects
+//!
+//! A codec pairs the fields of a Java class with members of a C++ struct.
+//! Names are compile-time packs and signatures come from mangler, so a
+//! mismatch can only surface once, when resolve() looks the IDs up through
+//! clas, like get_field, so stats, lookup profiles and warmup see them:
+//!
+//!   struct point { std::int32_t x; std::int32_t y; std::string label; };
+//!   using point_codec = jnipp::pojo::codec<point,
+//!       JNIPP_POJO_FIELD(point, x, 'x'),
+//!       JNIPP_POJO_FIELD(point, y, 'y'),
+//!       JNIPP_POJO_FIELD(point, label, 'l','a','b','e','l')>;
+//!   auto codec = *point_codec::resolve(*env.find_class("com/example/Point"));
+//!   jni_expected<point> p = codec.decode(env, obj);
+//!
+//! Decoding and encoding only read and write fields; no Java method runs.
+//! A codec holds field IDs only and may be shared between threads.
+//=============================================================================
+#ifndef JNIPP_JNIPP_POJO_HPP
+#define JNIPP_JNIPP_POJO_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace pojo {
+        // Get<Type>Field and Set<Type>Field for each JNI field type.
+        template<typename T>
+        struct accessor {};
+#define JNIPP_POJO_ACCESSOR_MAP(type, name) \
+        template<> struct accessor<type> { \
+            static type get(JNIEnv* env, jobject obj, jfieldID id){ return env->Get##name##Field(obj, id); } \
+            static void set(JNIEnv* env, jobject obj, jfieldID id, type v){ env->Set##name##Field(obj, id, v); } };
+        JNIPP_POJO_ACCESSOR_MAP(jboolean, Boolean)
+        JNIPP_POJO_ACCESSOR_MAP(jbyte, Byte)
+        JNIPP_POJO_ACCESSOR_MAP(jchar, Char)
+        JNIPP_POJO_ACCESSOR_MAP(jshort, Short)
+        JNIPP_POJO_ACCESSOR_MAP(jint, Int)
+        JNIPP_POJO_ACCESSOR_MAP(jlong, Long)
+        JNIPP_POJO_ACCESSOR_MAP(jfloat, Float)
+        JNIPP_POJO_ACCESSOR_MAP(jdouble, Double)
+        JNIPP_POJO_ACCESSOR_MAP(jobject, Object)
+#undef JNIPP_POJO_ACCESSOR_MAP
+
+        // How a C++ member is stored in a Java field. Arithmetic members
+        // use the Java type of the same width, as jnipp::element maps it;
+        // std::string maps to java.lang.String.
+        template<typename Member>
+        struct slot {
+            static_assert(!std::is_void<typename element<Member>::type>::value,
+                "pojo members must be bool, char, std::int8_t to std::int64_t, std::uint8_t to std::uint64_t, "
+                "float, double or std::string.");
+            using java = typename element<Member>::type;
+            static_assert(sizeof(java) == sizeof(Member), "Member width must match Java.");
+            using signature = mangle<java>;
+            static constexpr bool raises = false;
+            static Member read(JNIEnv* env, jobject obj, jfieldID id){
+                return static_cast<Member>(accessor<java>::get(env, obj, id));
+            }
+            static void write(JNIEnv* env, jobject obj, jfieldID id, Member const& v){
+                accessor<java>::set(env, obj, id, static_cast<java>(v));
+            }
+        };
+        template<>
+        struct slot<std::string> {
+            using signature = mangle<jnipp::jstring>;
+            // NewStringUTF and GetStringUTFChars may throw OutOfMemoryError.
+            static constexpr bool raises = true;
+            static std::string read(JNIEnv* env, jobject obj, jfieldID id){
+                auto s = static_cast<::jstring>(env->GetObjectField(obj, id));
+                auto r = detail::to_string(env, s);
+                env->DeleteLocalRef(s);
+                return r;
+            }
+            static void write(JNIEnv* env, jobject obj, jfieldID id, std::string const& v){
+                ::jstring s = env->NewStringUTF(v.c_str());
+                if(s == NULL) return;
+                env->SetObjectField(obj, id, s);
+                env->DeleteLocalRef(s);
+            }
+        };
+
+        template<typename Struct, typename Member, Member Struct::* Pointer, typename Name>
+        struct field {
+            using name = Name;
+            using signature = typename slot<Member>::signature;
+            static constexpr bool raises = slot<Member>::raises;
+            static void read(JNIEnv* env, jobject obj, jfieldID id, Struct& out){
+                out.*Pointer = slot<Member>::read(env, obj, id);
+            }
+            static void write(JNIEnv* env, jobject obj, jfieldID id, Struct const& in){
+                slot<Member>::write(env, obj, id, in.*Pointer);
+            }
+        };
+#define JNIPP_POJO_FIELD(Struct, member, ...) \
+    ::jnipp::pojo::field<Struct, decltype(Struct::member), &Struct::member, ::jnipp::pack<__VA_ARGS__>>
+
+        template<typename Struct, typename... Fields>
+        class codec {
+        private:
+            jfieldID ids[sizeof...(Fields)];
+
+            codec() noexcept = default;
+            template<std::size_t... I>
+            bool lookup(clas& c, std::index_sequence<I...>){
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok &&
+                    (ids[I] = c.lookup_field(Fields::name::str, Fields::signature::str)) != NULL, 0)... };
+                return ok;
+            }
+            // Stops after a field that raised, since no further field may be
+            // touched with an exception pending; primitive fields never do.
+            template<std::size_t... I>
+            bool read(JNIEnv* env, jobject obj, Struct& out, std::index_sequence<I...>) const {
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok && (Fields::read(env, obj, ids[I], out),
+                    !Fields::raises || env->ExceptionCheck() == JNI_FALSE), 0)... };
+                return ok;
+            }
+            template<std::size_t... I>
+            bool write(JNIEnv* env, jobject obj, Struct const& in, std::index_sequence<I...>) const {
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok && (Fields::write(env, obj, ids[I], in),
+                    !Fields::raises || env->ExceptionCheck() == JNI_FALSE), 0)... };
+                return ok;
+            }
+
+        public:
+            static jni_expected<codec> resolve(clas c){
+                codec k;
+                if(!k.lookup(c, std::index_sequence_for<Fields...>{})){
+                    return jni_raise(c.get_env(), exception_pending, "Field not found in pojo::codec::resolve function; describe() names it.");
+                }
+                return k;
+            }
+            // A bare jclass has no name for stats, profiles and warmup to
+            // key on; prefer the clas from find_class.
+            static jni_expected<codec> resolve(JNIEnv* env, jclass c){
+                return resolve(clas{ env, c });
+            }
+
+            jni_expected<Struct> decode(JNIEnv* env, jobject obj) const {
+                Struct out{};
+                if(!read(env, obj, out, std::index_sequence_for<Fields...>{})){
+                    return jni_raise(env, "Java exception thrown in pojo::codec::decode function.");
+                }
+                return out;
+            }
+            jni_expected<void> encode(JNIEnv* env, Struct const& in, jobject obj) const {
+                if(!write(env, obj, in, std::index_sequence_for<Fields...>{})){
+                    return jni_raise(env, "Java exception thrown in pojo::codec::encode function.");
+                }
+                return {};
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_POJO_HPP
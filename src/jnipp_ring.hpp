@@ -0,0 +1,286 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_ring.hpp
+//! \brief   JNI++ single-producer single-consumer ring in a direct ByteBuffer
+//!
+//! The ring lives in plain memory shared with Java through a direct
+//! ByteBuffer, so messages cross without any JNI call. Either side may be
+//! the producer; this header implements both halves in C++.
+//!
+//! Layout, native byte order, the region 64-byte aligned:
+//!
+//!   offset   size  field
+//!        0      8  head      bytes ever written; producer stores, release
+//!       64      8  tail      bytes ever read; consumer stores, release
+//!      128      8  capacity  data bytes, a power of two
+//!      136      4  magic     0x4a4e5252 ("JNRR")
+//!      140      4  version   1
+//!      192  cap.   data
+//!
+//! head and tail only grow; a position p lives at data[p & (capacity - 1)].
+//! Each record is an 8-byte header (int32 length, int32 kind) followed by
+//! the payload, padded to a multiple of 8. A record never wraps: when it
+//! does not fit before the end, the producer first fills the rest with a
+//! padding record (kind 1, length: bytes to the end - 8) that the consumer
+//! skips. Messages have kind 0.
+//!
+//! Java reads and writes head and tail with acquire/release semantics, e.g.
+//!
+//!   static final VarHandle LONG = MethodHandles.byteBufferViewVarHandle(
+//!       long[].class, ByteOrder.nativeOrder());
+//!   long head = (long) LONG.getAcquire(buf, 0);      // consumer
+//!   ... read records between tail and head ...
+//!   LONG.setRelease(buf, 64, tail);
+//!
+//! and ints with buf.order(ByteOrder.nativeOrder()).getInt(192 + index).
+//=============================================================================
+#ifndef JNIPP_JNIPP_RING_HPP
+#define JNIPP_JNIPP_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace ring {
+        constexpr std::size_t cache_line = 64;
+        constexpr std::uint32_t magic = 0x4a4e5252;
+        constexpr std::uint32_t version = 1;
+
+        // Padding keeps head and tail on their own cache lines, so the
+        // producer and consumer never write the same line.
+        struct header {
+            std::atomic<std::uint64_t> head;
+            char pad0[cache_line - sizeof(std::uint64_t)];
+            std::atomic<std::uint64_t> tail;
+            char pad1[cache_line - sizeof(std::uint64_t)];
+            std::uint64_t capacity;
+            std::uint32_t magic;
+            std::uint32_t version;
+            char pad2[cache_line - 2 * sizeof(std::uint64_t)];
+        };
+        static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t),
+            "The ring layout needs plain 64-bit atomics.");
+        static_assert(offsetof(header, tail) == 64 && offsetof(header, capacity) == 128 &&
+            offsetof(header, magic) == 136 && sizeof(header) == 192, "Ring layout changed.");
+
+        constexpr std::size_t record_header = 8;
+        enum class kind : std::int32_t {
+            message = 0,
+            padding = 1,
+        };
+
+        inline std::uint64_t align8(std::uint64_t n) noexcept {
+            return (n + 7) & ~std::uint64_t{ 7 };
+        }
+        // Total bytes of a ring with the given data capacity.
+        inline std::size_t bytes_for(std::uint64_t capacity) noexcept {
+            return sizeof(header) + static_cast<std::size_t>(capacity);
+        }
+
+        class view {
+        private:
+            header* h = nullptr;
+            unsigned char* data = nullptr;
+            std::uint64_t mask = 0;
+
+            view(header* h) noexcept
+                : h{ h }, data{ reinterpret_cast<unsigned char*>(h + 1) }, mask{ h->capacity - 1 } {}
+
+            friend view format(void*, std::uint64_t) noexcept;
+            friend view open(void*, std::size_t) noexcept;
+
+        public:
+            view() noexcept = default;
+            explicit operator bool() const noexcept {
+                return h != nullptr;
+            }
+            void* memory() const noexcept {
+                return h;
+            }
+            std::uint64_t capacity() const noexcept {
+                return mask + 1;
+            }
+            std::size_t size_bytes() const noexcept {
+                return bytes_for(capacity());
+            }
+
+            // Producer side. fill(void*) writes exactly n payload bytes in
+            // place; returns false without calling it if the ring is full.
+            // A record that fits only after the wrap may need the space
+            // before the end, still unread, as padding: then the padding
+            // alone is published and false returned, and the record fits
+            // once the consumer has passed it.
+            template<typename F>
+            bool write(std::uint32_t n, F&& fill){
+                auto record = align8(record_header + n);
+                if(n > static_cast<std::uint32_t>(std::numeric_limits<std::int32_t>::max()) || record > capacity()){
+                    return false;
+                }
+                auto head = h->head.load(std::memory_order_relaxed);
+                auto tail = h->tail.load(std::memory_order_acquire);
+                auto index = head & mask;
+                auto to_end = capacity() - index;
+                auto padding = to_end < record ? to_end : 0;
+                if(head + padding - tail > capacity()) return false;
+                if(padding != 0){
+                    put_header(index, static_cast<std::int32_t>(padding - record_header), kind::padding);
+                    head += padding;
+                    index = 0;
+                    if(head + record - tail > capacity()){
+                        h->head.store(head, std::memory_order_release);
+                        return false;
+                    }
+                }
+                else if(head + record - tail > capacity()){
+                    return false;
+                }
+                put_header(index, static_cast<std::int32_t>(n), kind::message);
+                fill(static_cast<void*>(data + index + record_header));
+                h->head.store(head + record, std::memory_order_release);
+                return true;
+            }
+            bool write(void const* p, std::uint32_t n){
+                return write(n, [&](void* out){ std::memcpy(out, p, n); });
+            }
+
+            // Consumer side. Calls f(void const* payload, std::uint32_t n)
+            // for up to max records and returns how many were read. The
+            // payload is only valid during the call.
+            //
+            // The header and every record come from memory Java may write,
+            // so none is trusted: a head more than capacity ahead, a
+            // negative length, or a record running past the end of the data
+            // or past head stops the read with an error. Records before it
+            // are consumed; tail stays on the bad one, so the ring is never
+            // walked off.
+            template<typename F>
+            ornew::expected<std::size_t> read(F&& f, std::size_t max = std::numeric_limits<std::size_t>::max()){
+                auto tail = h->tail.load(std::memory_order_relaxed);
+                auto head = h->head.load(std::memory_order_acquire);
+                if(head - tail > capacity()){
+                    return ornew::raise<ornew::error::basic_error>("Head out of range in ring::view::read function.");
+                }
+                std::size_t count = 0;
+                char const* malformed = nullptr;
+                while(tail != head && count < max){
+                    auto index = tail & mask;
+                    std::int32_t length;
+                    std::int32_t k;
+                    std::memcpy(&length, data + index, sizeof(length));
+                    std::memcpy(&k, data + index + sizeof(length), sizeof(k));
+                    auto record = align8(record_header + static_cast<std::uint64_t>(length));
+                    if(length < 0 || index + record_header + static_cast<std::uint64_t>(length) > capacity() ||
+                       record > head - tail){
+                        malformed = "Malformed record in ring::view::read function.";
+                        break;
+                    }
+                    if(k == static_cast<std::int32_t>(kind::message)){
+                        f(static_cast<void const*>(data + index + record_header), static_cast<std::uint32_t>(length));
+                        ++count;
+                    }
+                    tail += record;
+                }
+                h->tail.store(tail, std::memory_order_release);
+                if(malformed != nullptr) return ornew::raise<ornew::error::basic_error>(malformed);
+                return count;
+            }
+
+        private:
+            void put_header(std::uint64_t index, std::int32_t length, kind k) noexcept {
+                std::int32_t value = static_cast<std::int32_t>(k);
+                std::memcpy(data + index, &length, sizeof(length));
+                std::memcpy(data + index + sizeof(length), &value, sizeof(value));
+            }
+        };
+
+        // Lays out an empty ring. memory must be 64-byte aligned and
+        // bytes_for(capacity) long; capacity a power of two of at least 64.
+        inline view format(void* memory, std::uint64_t capacity) noexcept {
+            if(memory == nullptr || reinterpret_cast<std::uintptr_t>(memory) % cache_line != 0 ||
+               capacity < cache_line || (capacity & (capacity - 1)) != 0){
+                return view{};
+            }
+            std::memset(memory, 0, sizeof(header));
+            auto h = new(memory) header;
+            h->head.store(0, std::memory_order_relaxed);
+            h->tail.store(0, std::memory_order_relaxed);
+            h->capacity = capacity;
+            h->magic = magic;
+            h->version = version;
+            return view{ h };
+        }
+        // Adopts a ring already laid out, by format() or by the Java side.
+        inline view open(void* memory, std::size_t bytes) noexcept {
+            if(memory == nullptr || reinterpret_cast<std::uintptr_t>(memory) % cache_line != 0 ||
+               bytes < sizeof(header)){
+                return view{};
+            }
+            auto h = static_cast<header*>(memory);
+            auto capacity = h->capacity;
+            if(h->magic != magic || h->version != version || capacity < cache_line ||
+               (capacity & (capacity - 1)) != 0 || bytes < bytes_for(capacity)){
+                return view{};
+            }
+            return view{ h };
+        }
+
+        // Owns the memory of a ring. It must outlive every Java buffer
+        // created over it.
+        class buffer {
+        private:
+            void* memory;
+            view v;
+        public:
+            // capacity is rounded up to a power of two of at least 64.
+            explicit buffer(std::uint64_t capacity){
+                std::uint64_t c = cache_line;
+                while(c < capacity) c <<= 1;
+                auto bytes = bytes_for(c) + cache_line;
+                memory = ::operator new(bytes);
+                JNIPP_MEMORY_ACQUIRE(ring, bytes);
+                auto aligned = (reinterpret_cast<std::uintptr_t>(memory) + cache_line - 1) & ~std::uintptr_t{ cache_line - 1 };
+                v = format(reinterpret_cast<void*>(aligned), c);
+            }
+            buffer(buffer const&) = delete;
+            buffer& operator=(buffer const&) = delete;
+            ~buffer(){
+                JNIPP_MEMORY_RELEASE(ring, v.size_bytes() + cache_line);
+                ::operator delete(memory);
+            }
+            view& get() noexcept {
+                return v;
+            }
+        };
+
+        // A direct ByteBuffer over the whole ring, header included.
+        inline jni_expected<jobject> to_java(JNIEnv* env, view const& v){
+            jobject b = env->NewDirectByteBuffer(v.memory(), static_cast<jlong>(v.size_bytes()));
+            if(b == NULL){
+                return jni_raise(env, "NewDirectByteBuffer failed in ring::to_java function.");
+            }
+            return b;
+        }
+        // The ring inside a direct ByteBuffer laid out by the other side.
+        inline jni_expected<view> from_java(JNIEnv* env, jobject buffer){
+            auto v = open(env->GetDirectBufferAddress(buffer),
+                static_cast<std::size_t>(env->GetDirectBufferCapacity(buffer)));
+            if(!v){
+                return jni_raise(env, "Not a ring in ring::from_java function.");
+            }
+            return v;
+        }
+    }
+}
+#endif // JNIPP_JNIPP_RING_HPP
@@ -0,0 +1,172 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_soa.hpp
+//! \brief   JNI++ struct-of-arrays marshalling of C++ records
+//!
+//! A layout lists the members of a struct that Java receives; each becomes
+//! one primitive array, so a whole vector of records crosses JNI as a
+//! handful of arrays instead of one Java object per record:
+//!
+//!   struct quote { std::int64_t time; double bid; double ask; };
+//!   using quotes = jnipp::soa::layout<quote,
+//!       JNIPP_SOA_FIELD(quote, time), JNIPP_SOA_FIELD(quote, bid), JNIPP_SOA_FIELD(quote, ask)>;
+//!   // Java: void onQuotes(long[] time, double[] bid, double[] ask)
+//!   auto on_quotes = *sink_class.get_method<quotes::signature<void>>("onQuotes");
+//!   quotes::invoke(env, on_quotes, sink, records);
+//!
+//! Members may be bool, char, the fixed-width integers, float and double;
+//! each fills the Java array of the same width, as jnipp::element maps it.
+//=============================================================================
+#ifndef JNIPP_JNIPP_SOA_HPP
+#define JNIPP_JNIPP_SOA_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "jnipp.hpp"
+
+namespace jnipp {
+    namespace soa {
+        // Java array type and bulk operations for each primitive.
+        template<typename T>
+        struct array_of {};
+#define JNIPP_SOA_ARRAY_MAP(type_, name) \
+        template<> struct array_of<type_> { \
+            using type = type_##Array; \
+            static type create(JNIEnv* env, jsize n){ return env->New##name##Array(n); } \
+            static void set(JNIEnv* env, type a, jsize n, type_ const* v){ env->Set##name##ArrayRegion(a, 0, n, v); } };
+        JNIPP_SOA_ARRAY_MAP(jboolean, Boolean)
+        JNIPP_SOA_ARRAY_MAP(jbyte, Byte)
+        JNIPP_SOA_ARRAY_MAP(jchar, Char)
+        JNIPP_SOA_ARRAY_MAP(jshort, Short)
+        JNIPP_SOA_ARRAY_MAP(jint, Int)
+        JNIPP_SOA_ARRAY_MAP(jlong, Long)
+        JNIPP_SOA_ARRAY_MAP(jfloat, Float)
+        JNIPP_SOA_ARRAY_MAP(jdouble, Double)
+#undef JNIPP_SOA_ARRAY_MAP
+
+        // One member of Struct, as one Java array of the same width.
+        template<typename Struct, typename Member, Member Struct::* Pointer>
+        struct field {
+            static_assert(!std::is_void<typename element<Member>::type>::value,
+                "soa::field members must be bool, char, std::int8_t to std::int64_t, std::uint8_t to std::uint64_t, "
+                "float or double.");
+            using member_type = Member;
+            using type = typename element<Member>::type;
+            static_assert(sizeof(type) == sizeof(Member), "Member width must match Java.");
+            using array = typename array_of<type>::type;
+            static type get(Struct const& s) noexcept {
+                return static_cast<type>(s.*Pointer);
+            }
+        };
+#define JNIPP_SOA_FIELD(Struct, member) \
+    ::jnipp::soa::field<Struct, decltype(Struct::member), &Struct::member>
+
+        template<typename Struct, typename... Fields>
+        class layout {
+        public:
+            using arrays = std::tuple<typename Fields::array...>;
+            // Java method taking the arrays after any leading parameters.
+            template<typename Return, typename... Leading>
+            using signature = Return(Leading..., typename Fields::array...);
+
+        private:
+            using indices = std::index_sequence_for<Fields...>;
+
+            // Gathers one member straight into the pinned array; no staging
+            // buffer, and a loop simple enough for the compiler to vectorize.
+            template<typename Field>
+            static bool fill(JNIEnv* env, typename Field::array a, Struct const* records, std::size_t n){
+                if(n == 0) return true;
+                auto out = static_cast<typename Field::type*>(env->GetPrimitiveArrayCritical(a, NULL));
+                if(out == NULL) return false;
+                for(std::size_t i = 0; i < n; ++i){
+                    out[i] = Field::get(records[i]);
+                }
+                env->ReleasePrimitiveArrayCritical(a, out, 0);
+                return true;
+            }
+            // Stops at the first failure: no JNI call may follow a pending
+            // OutOfMemoryError.
+            template<std::size_t... I>
+            static bool build(JNIEnv* env, arrays& a, Struct const* records, std::size_t n, std::index_sequence<I...>){
+                bool ok = true;
+                (void)std::initializer_list<int>{ (ok = ok &&
+                    (std::get<I>(a) = array_of<typename Fields::type>::create(env, static_cast<jsize>(n))) != NULL &&
+                    fill<Fields>(env, std::get<I>(a), records, n), 0)... };
+                return ok;
+            }
+            template<std::size_t... I>
+            static void release(JNIEnv* env, arrays const& a, std::index_sequence<I...>){
+                (void)std::initializer_list<int>{ (env->DeleteLocalRef(std::get<I>(a)), 0)... };
+            }
+            template<typename T, typename Policy, typename... Leading, std::size_t... I>
+            static jni_expected<void> call(std::true_type, JNIEnv* env, method<T, Policy>& m, jobject obj,
+                    arrays const& a, std::index_sequence<I...>, Leading... leading){
+                m(obj, leading..., std::get<I>(a)...);
+                release(env, a, indices{});
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    return jni_raise(env, "Java exception thrown in soa::layout::invoke function.");
+                }
+                return {};
+            }
+            template<typename T, typename Policy, typename... Leading, std::size_t... I>
+            static jni_expected<T> call(std::false_type, JNIEnv* env, method<T, Policy>& m, jobject obj,
+                    arrays const& a, std::index_sequence<I...>, Leading... leading){
+                auto r = m(obj, leading..., std::get<I>(a)...);
+                release(env, a, indices{});
+                if(env->ExceptionCheck() == JNI_TRUE){
+                    return jni_raise(env, "Java exception thrown in soa::layout::invoke function.");
+                }
+                return value_of(r);
+            }
+            template<typename T>
+            static T value_of(T v) noexcept {
+                return v;
+            }
+            template<typename T>
+            static T value_of(jni_expected<T>& r){
+                return *r;
+            }
+
+        public:
+            // Local references to one new array per field.
+            static jni_expected<arrays> to_java(JNIEnv* env, Struct const* records, std::size_t n){
+                arrays a{};
+                if(!build(env, a, records, n, indices{})){
+                    // DeleteLocalRef is allowed with an exception pending.
+                    release(env, a, indices{});
+                    return jni_raise(env, "Array allocation failed in soa::layout::to_java function.");
+                }
+                return a;
+            }
+            static jni_expected<arrays> to_java(JNIEnv* env, std::vector<Struct> const& records){
+                return to_java(env, records.data(), records.size());
+            }
+            static void release(JNIEnv* env, arrays const& a){
+                release(env, a, indices{});
+            }
+
+            // Marshals the records and passes them to m in a single call,
+            // after any leading arguments. The arrays are released afterwards.
+            template<typename T, typename Policy, typename... Leading>
+            static jni_expected<T> invoke(JNIEnv* env, method<T, Policy> m, jobject obj,
+                    std::vector<Struct> const& records, Leading... leading){
+                return to_java(env, records).and_then([&](arrays const& a){
+                    return call(std::is_void<T>{}, env, m, obj, a, indices{}, leading...);
+                });
+            }
+        };
+    }
+}
+#endif // JNIPP_JNIPP_SOA_HPP
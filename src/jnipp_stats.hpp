@@ -0,0 +1,265 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_stats.hpp
+//! \brief   JNI++ call counters and latency histograms
+//!
+//! Included by jnipp.hpp when JNIPP_ENABLE_STATS is defined. Each thread
+//! records into its own shard; snapshot() merges all shards.
+//!
+//! Calls are keyed by method ID, which stays valid while the class is
+//! loaded. Lookups are keyed by the interned class name, since a jclass is
+//! a local reference whose value changes from one lookup to the next.
+//=============================================================================
+#ifndef JNIPP_JNIPP_STATS_HPP
+#define JNIPP_JNIPP_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "jnipp_names.hpp"
+
+#ifndef JNIPP_STATS_CAPACITY
+// Distinct (operation, id) keys a single thread can record.
+#define JNIPP_STATS_CAPACITY 256
+#endif
+
+namespace jnipp {
+    namespace stats {
+        enum class op : std::uint8_t {
+            call,
+            find_class,
+            get_method,
+            get_field,
+        };
+
+        // Bucket i holds latencies in [2^(i-1), 2^i) nanoseconds; bucket 0
+        // holds zero.
+        constexpr std::size_t bucket_count = 64;
+
+        inline std::size_t bucket_of(std::uint64_t ns) noexcept {
+            std::size_t b = 0;
+            while(ns != 0){
+                ns >>= 1;
+                ++b;
+            }
+            return b < bucket_count ? b : bucket_count - 1;
+        }
+
+        struct entry {
+            op operation;
+            void const* id;
+            // "class.method(signature)" for a call, the class for a lookup;
+            // empty for a method whose lookup was not recorded.
+            char const* name;
+            std::uint64_t count;
+            std::uint64_t total_ns;
+            std::uint64_t buckets[bucket_count];
+
+            // Upper bound of the bucket containing quantile q (0..1).
+            std::uint64_t percentile(double q) const noexcept {
+                if(count == 0) return 0;
+                auto target = static_cast<std::uint64_t>(q * static_cast<double>(count));
+                if(target >= count) target = count - 1;
+                std::uint64_t seen = 0;
+                for(std::size_t i = 0; i < bucket_count; ++i){
+                    seen += buckets[i];
+                    if(seen > target){
+                        return i == 0 ? 0 : (std::uint64_t{ 1 } << i) - 1;
+                    }
+                }
+                return 0;
+            }
+        };
+
+        namespace detail {
+            // Written only by the owning thread; read concurrently by
+            // snapshot(), hence relaxed atomics instead of plain integers.
+            struct record {
+                std::atomic<void const*> id;
+                std::atomic<std::uint8_t> operation;
+                std::atomic<bool> used;
+                std::atomic<std::uint64_t> count;
+                std::atomic<std::uint64_t> total_ns;
+                std::atomic<std::uint64_t> buckets[bucket_count];
+            };
+
+            struct shard {
+                record records[JNIPP_STATS_CAPACITY] = {};
+                std::atomic<std::uint64_t> dropped{ 0 };
+                std::atomic<bool> in_use{ true };
+
+                record* find(op o, void const* id) noexcept {
+                    auto h = (reinterpret_cast<std::uintptr_t>(id) >> 3) * 31 + static_cast<std::uintptr_t>(o);
+                    for(std::size_t i = 0; i < JNIPP_STATS_CAPACITY; ++i){
+                        auto& r = records[(h + i) % JNIPP_STATS_CAPACITY];
+                        if(!r.used.load(std::memory_order_relaxed)){
+                            r.id.store(id, std::memory_order_relaxed);
+                            r.operation.store(static_cast<std::uint8_t>(o), std::memory_order_relaxed);
+                            r.used.store(true, std::memory_order_release);
+                            return &r;
+                        }
+                        if(r.id.load(std::memory_order_relaxed) == id &&
+                           r.operation.load(std::memory_order_relaxed) == static_cast<std::uint8_t>(o)){
+                            return &r;
+                        }
+                    }
+                    return nullptr;
+                }
+                void add(op o, void const* id, std::uint64_t ns) noexcept {
+                    record* r = find(o, id);
+                    if(r == nullptr){
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    auto bump = [](std::atomic<std::uint64_t>& a, std::uint64_t v){
+                        a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+                    };
+                    bump(r->count, 1);
+                    bump(r->total_ns, ns);
+                    bump(r->buckets[bucket_of(ns)], 1);
+                }
+            };
+
+            // Shards are never freed: a retired shard keeps its counts and is
+            // handed to the next thread that starts recording.
+            struct registry {
+                std::mutex lock;
+                std::vector<std::unique_ptr<shard>> shards;
+
+                static registry& instance(){
+                    static registry r;
+                    return r;
+                }
+                shard* acquire(){
+                    std::lock_guard<std::mutex> guard{ lock };
+                    for(auto& s : shards){
+                        bool expected = false;
+                        if(s->in_use.compare_exchange_strong(expected, true)){
+                            return s.get();
+                        }
+                    }
+                    shards.emplace_back(new shard{});
+                    return shards.back().get();
+                }
+            };
+
+            struct shard_holder {
+                shard* s;
+                shard_holder()
+                    : s{ registry::instance().acquire() } {}
+                ~shard_holder(){
+                    s->in_use.store(false, std::memory_order_release);
+                }
+            };
+
+            // Names of method IDs, written per lookup and read by snapshot().
+            struct labels {
+                std::mutex lock;
+                std::unordered_map<void const*, char const*> names;
+
+                static labels& instance(){
+                    static labels l;
+                    return l;
+                }
+                char const* find(void const* id){
+                    std::lock_guard<std::mutex> guard{ lock };
+                    auto it = names.find(id);
+                    return it == names.end() ? "" : it->second;
+                }
+            };
+
+            inline shard& local_shard(){
+                static thread_local shard_holder holder;
+                return *holder.s;
+            }
+        }
+
+        inline void record(op o, void const* id, std::uint64_t ns) noexcept {
+            detail::local_shard().add(o, id, ns);
+        }
+
+        // Names the calls recorded for a method ID. Called per lookup.
+        inline void label(void const* id, char const* clas, char const* name, char const* signature){
+            auto n = names::intern((std::string{ clas } + '.' + name + signature).c_str());
+            auto& l = detail::labels::instance();
+            std::lock_guard<std::mutex> guard{ l.lock };
+            l.names[id] = n;
+        }
+
+        // Times the enclosing block.
+        class scope {
+        private:
+            op o;
+            void const* id;
+            std::chrono::steady_clock::time_point begin;
+        public:
+            scope(op o, void const* id) noexcept
+                : o{ o }, id{ id }, begin{ std::chrono::steady_clock::now() } {}
+            scope(scope const&) = delete;
+            scope& operator=(scope const&) = delete;
+            ~scope(){
+                auto end = std::chrono::steady_clock::now();
+                record(o, id, static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            }
+        };
+
+        // Merges every shard. Counts recorded concurrently may be partially
+        // included.
+        inline std::vector<entry> snapshot(){
+            auto& reg = detail::registry::instance();
+            std::vector<entry> out;
+            std::lock_guard<std::mutex> guard{ reg.lock };
+            for(auto& s : reg.shards){
+                for(auto& r : s->records){
+                    if(!r.used.load(std::memory_order_acquire)) continue;
+                    auto o = static_cast<op>(r.operation.load(std::memory_order_relaxed));
+                    auto id = r.id.load(std::memory_order_relaxed);
+                    entry* e = nullptr;
+                    for(auto& x : out){
+                        if(x.operation == o && x.id == id){
+                            e = &x;
+                            break;
+                        }
+                    }
+                    if(e == nullptr){
+                        auto name = o == op::call ? detail::labels::instance().find(id) : static_cast<char const*>(id);
+                        out.push_back(entry{ o, id, name, 0, 0, {} });
+                        e = &out.back();
+                    }
+                    e->count += r.count.load(std::memory_order_relaxed);
+                    e->total_ns += r.total_ns.load(std::memory_order_relaxed);
+                    for(std::size_t i = 0; i < bucket_count; ++i){
+                        e->buckets[i] += r.buckets[i].load(std::memory_order_relaxed);
+                    }
+                }
+            }
+            return out;
+        }
+
+        // Records that did not fit into a shard.
+        inline std::uint64_t dropped(){
+            auto& reg = detail::registry::instance();
+            std::lock_guard<std::mutex> guard{ reg.lock };
+            std::uint64_t n = 0;
+            for(auto& s : reg.shards){
+                n += s->dropped.load(std::memory_order_relaxed);
+            }
+            return n;
+        }
+    }
+}
+#endif // JNIPP_JNIPP_STATS_HPP
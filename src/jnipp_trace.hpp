@@ -0,0 +1,226 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_trace.hpp
+//! \brief   JNI++ timeline tracing in Chrome trace event format
+//!
+//! Included by jnipp.hpp when JNIPP_ENABLE_TRACE is defined; the macro must
+//! be set identically in every translation unit since it changes the layout
+//! of method<> and clas. Each thread appends to its own ring buffer and
+//! flush_chrome_json() drains all of them into a file that chrome://tracing
+//! and the Perfetto UI open directly.
+//!
+//! Only method calls and field accesses are traced. Class, method and field
+//! lookups are not: they run once per site, and stats and lookup_profile
+//! already time them.
+//=============================================================================
+#ifndef JNIPP_JNIPP_TRACE_HPP
+#define JNIPP_JNIPP_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jnipp_names.hpp"
+
+#ifndef JNIPP_TRACE_CAPACITY
+// Events per thread; must be a power of two.
+#define JNIPP_TRACE_CAPACITY (1u << 14)
+#endif
+
+namespace jnipp {
+    namespace trace {
+        static_assert((JNIPP_TRACE_CAPACITY & (JNIPP_TRACE_CAPACITY - 1)) == 0,
+            "JNIPP_TRACE_CAPACITY must be a power of two.");
+
+        // What an event refers to. Sites are interned and live until exit.
+        struct site {
+            char const* clas;
+            char const* name;
+            char const* signature;
+        };
+
+        namespace detail {
+            struct site_table {
+                std::mutex lock;
+                std::deque<site> sites;
+
+                static site_table& instance(){
+                    static site_table t;
+                    return t;
+                }
+            };
+        }
+
+        // Copies the strings; called once per lookup, never per call.
+        inline site const* intern(char const* clas, char const* name, char const* signature){
+            auto c = names::intern(clas);
+            auto n = names::intern(name);
+            auto s = names::intern(signature);
+            auto& t = detail::site_table::instance();
+            std::lock_guard<std::mutex> guard{ t.lock };
+            for(auto& x : t.sites){
+                if(x.clas == c && x.name == n && x.signature == s) return &x;
+            }
+            t.sites.push_back(site{ c, n, s });
+            return &t.sites.back();
+        }
+
+        inline std::uint64_t now_ns() noexcept {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        struct event {
+            site const* where;
+            std::uint64_t begin_ns;
+            std::uint64_t end_ns;
+        };
+
+        namespace detail {
+            // Single producer (the owning thread), single consumer (flush).
+            struct ring {
+                event events[JNIPP_TRACE_CAPACITY];
+                std::atomic<std::uint64_t> head{ 0 };
+                std::atomic<std::uint64_t> tail{ 0 };
+                std::atomic<std::uint64_t> dropped{ 0 };
+                std::atomic<bool> in_use{ true };
+                std::uint32_t tid;
+
+                explicit ring(std::uint32_t tid)
+                    : tid{ tid } {}
+                void push(event const& e) noexcept {
+                    auto h = head.load(std::memory_order_relaxed);
+                    if(h - tail.load(std::memory_order_acquire) == JNIPP_TRACE_CAPACITY){
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    events[h & (JNIPP_TRACE_CAPACITY - 1)] = e;
+                    head.store(h + 1, std::memory_order_release);
+                }
+            };
+
+            struct ring_registry {
+                std::mutex lock;
+                std::vector<std::unique_ptr<ring>> rings;
+
+                static ring_registry& instance(){
+                    static ring_registry r;
+                    return r;
+                }
+                ring* acquire(){
+                    std::lock_guard<std::mutex> guard{ lock };
+                    for(auto& r : rings){
+                        bool expected = false;
+                        if(r->in_use.compare_exchange_strong(expected, true)){
+                            return r.get();
+                        }
+                    }
+                    rings.emplace_back(new ring{ static_cast<std::uint32_t>(rings.size() + 1) });
+                    return rings.back().get();
+                }
+            };
+
+            struct ring_holder {
+                ring* r;
+                ring_holder()
+                    : r{ ring_registry::instance().acquire() } {}
+                ~ring_holder(){
+                    r->in_use.store(false, std::memory_order_release);
+                }
+            };
+
+            inline ring& local_ring(){
+                static thread_local ring_holder holder;
+                return *holder.r;
+            }
+
+            inline void write_json_string(std::FILE* f, char const* s){
+                std::fputc('"', f);
+                for(; *s != '\0'; ++s){
+                    auto c = static_cast<unsigned char>(*s);
+                    if(c == '"' || c == '\\') std::fputc('\\', f);
+                    if(c < 0x20) std::fprintf(f, "\\u%04x", c);
+                    else std::fputc(c, f);
+                }
+                std::fputc('"', f);
+            }
+        }
+
+        // Records a finished span; usable for native spans too.
+        inline void record(site const* where, std::uint64_t begin_ns, std::uint64_t end_ns) noexcept {
+            detail::local_ring().push(event{ where, begin_ns, end_ns });
+        }
+
+        class scope {
+        private:
+            site const* where;
+            std::uint64_t begin;
+        public:
+            explicit scope(site const* where) noexcept
+                : where{ where }, begin{ now_ns() } {}
+            scope(scope const&) = delete;
+            scope& operator=(scope const&) = delete;
+            ~scope(){
+                if(where != nullptr) record(where, begin, now_ns());
+            }
+        };
+
+        // Drains every ring into a Chrome trace JSON file of complete ("X")
+        // events, timestamps in microseconds of steady_clock. Returns false
+        // if the file cannot be written.
+        inline bool flush_chrome_json(char const* path){
+            std::FILE* f = std::fopen(path, "w");
+            if(f == nullptr) return false;
+            std::fputs("{\"traceEvents\":[", f);
+            bool first = true;
+            auto& reg = detail::ring_registry::instance();
+            std::lock_guard<std::mutex> guard{ reg.lock };
+            for(auto& r : reg.rings){
+                auto t = r->tail.load(std::memory_order_relaxed);
+                auto h = r->head.load(std::memory_order_acquire);
+                for(; t != h; ++t){
+                    auto const& e = r->events[t & (JNIPP_TRACE_CAPACITY - 1)];
+                    std::fputs(first ? "\n" : ",\n", f);
+                    first = false;
+                    std::fputs("{\"name\":", f);
+                    detail::write_json_string(f, (std::string{ e.where->clas } + "." + e.where->name).c_str());
+                    std::fputs(",\"cat\":\"jni\",\"ph\":\"X\"", f);
+                    std::fprintf(f, ",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+                        static_cast<double>(e.begin_ns) / 1000.0,
+                        static_cast<double>(e.end_ns - e.begin_ns) / 1000.0, r->tid);
+                    std::fputs(",\"args\":{\"signature\":", f);
+                    detail::write_json_string(f, e.where->signature);
+                    std::fputs("}}", f);
+                }
+                r->tail.store(t, std::memory_order_release);
+            }
+            std::fputs("\n]}\n", f);
+            return std::fclose(f) == 0;
+        }
+
+        // Events lost because a ring was full.
+        inline std::uint64_t dropped(){
+            auto& reg = detail::ring_registry::instance();
+            std::lock_guard<std::mutex> guard{ reg.lock };
+            std::uint64_t n = 0;
+            for(auto& r : reg.rings){
+                n += r->dropped.load(std::memory_order_relaxed);
+            }
+            return n;
+        }
+    }
+}
+#endif // JNIPP_JNIPP_TRACE_HPP
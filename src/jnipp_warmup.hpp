@@ -0,0 +1,298 @@
+//=============================================================================
+//       _   _   _   _____
+//      | | | \ | | |_   _|    _     _
+//      | | |  \| |   | |    _| |_ _| |_
+//  _   | | | . ` |   | |   |_   _|_   _|
+// | |__| | | |\  |  _| |_    |_|   |_|
+//  \____/  |_| \_| |_____|
+//!
+//! \file    jnipp/jnipp_warmup.hpp
+//! \brief   JNI++ profile-guided binding warmup
+//!
+//! Included by jnipp.hpp when JNIPP_ENABLE_WARMUP is defined. Every class,
+//! method and field resolved through jnipp is remembered; save() writes
+//! them to a profile, and load() resolves a profile eagerly so that later
+//! lookups of the same bindings are served from a cache:
+//!
+//!   JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void*){
+//!       ...
+//!       jnipp::warmup::load(env, "/var/cache/app/jnipp.warmup");
+//!   }
+//!   // at shutdown, or once the service has settled
+//!   jnipp::warmup::save("/var/cache/app/jnipp.warmup");
+//!
+//! The profile is plain text, one binding per line after a header line:
+//!
+//!   jnipp-warmup 1
+//!   C<TAB>com/x/Foo
+//!   M<TAB>com/x/Foo<TAB>add<TAB>(I)I
+//!   F<TAB>com/x/Foo<TAB>x<TAB>I
+//!
+//! The cache is keyed by class name only, not by class loader: a class of
+//! the same name loaded by another loader is served the first one's IDs.
+//! Applications with several loaders must not enable warmup.
+//!
+//! Each thread remembers what it already looked up, so repeated lookups
+//! take no lock; load() and unload() invalidate those memos.
+//=============================================================================
+#ifndef JNIPP_JNIPP_WARMUP_HPP
+#define JNIPP_JNIPP_WARMUP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <jni.h>
+
+#include "jnipp_names.hpp"
+
+namespace jnipp {
+    namespace warmup {
+        enum class kind : char {
+            clas = 'C',
+            method = 'M',
+            field = 'F',
+        };
+
+        namespace detail {
+            // Interned class, member and signature.
+            using key = std::tuple<char const*, char const*, char const*>;
+
+            struct binding {
+                kind what;
+                key where;
+            };
+
+            struct state {
+                std::mutex lock;
+                // Lookups made by this process, in first-resolved order so
+                // that a class precedes its members in the profile.
+                std::vector<binding> resolved;
+                std::set<std::pair<kind, key>> seen;
+                // Filled by load(); classes are global references.
+                std::map<char const*, jclass> classes;
+                std::map<key, jmethodID> methods;
+                std::map<key, jfieldID> fields;
+                // Bumped by load() and unload(); per-thread memos of an
+                // older generation are stale.
+                std::atomic<unsigned> generation{ 0 };
+
+                static state& instance(){
+                    static state s;
+                    return s;
+                }
+                void remember(kind what, key const& k){
+                    if(seen.emplace(what, k).second) resolved.push_back(binding{ what, k });
+                }
+            };
+
+            inline key intern(char const* clas, char const* name, char const* signature){
+                return key{ names::intern(clas), names::intern(name), names::intern(signature) };
+            }
+
+            // A binding this thread already remembered, and the warm
+            // cache's ID for it (NULL if not cached) as of generation.
+            template<typename Id>
+            struct local_entry {
+                unsigned generation;
+                Id id;
+            };
+            template<typename Key, typename Id>
+            std::map<Key, local_entry<Id>>& local_seen(){
+                static thread_local std::map<Key, local_entry<Id>> seen;
+                return seen;
+            }
+
+            template<typename Map, typename Resolve>
+            auto member(Map& cache, kind what, char const* clas, char const* name, char const* signature,
+                    Resolve&& resolve) -> typename Map::mapped_type {
+                // Classes built from a bare jclass have no name to key on.
+                if(clas == nullptr || *clas == '\0') return resolve();
+                using id_type = typename Map::mapped_type;
+                auto k = intern(clas, name, signature);
+                auto& s = state::instance();
+                auto& local = local_seen<key, id_type>();
+                auto generation = s.generation.load(std::memory_order_acquire);
+                auto l = local.find(k);
+                if(l != local.end() && l->second.generation == generation){
+                    return l->second.id != NULL ? l->second.id : resolve();
+                }
+                {
+                    std::lock_guard<std::mutex> guard{ s.lock };
+                    auto it = cache.find(k);
+                    if(it != cache.end()){
+                        s.remember(what, k);
+                        local[k] = local_entry<id_type>{ generation, it->second };
+                        return it->second;
+                    }
+                }
+                auto id = resolve();
+                if(id != NULL){
+                    std::lock_guard<std::mutex> guard{ s.lock };
+                    s.remember(what, k);
+                    local[k] = local_entry<id_type>{ generation, NULL };
+                }
+                return id;
+            }
+        }
+
+        // Returns a new local reference, from the warm cache if possible.
+        template<typename Resolve>
+        jclass find_class(JNIEnv* env, char const* name, Resolve&& resolve){
+            auto n = names::intern(name);
+            auto& s = detail::state::instance();
+            auto& local = detail::local_seen<char const*, jclass>();
+            auto generation = s.generation.load(std::memory_order_acquire);
+            auto l = local.find(n);
+            if(l != local.end() && l->second.generation == generation){
+                return l->second.id != NULL ? static_cast<jclass>(env->NewLocalRef(l->second.id)) : resolve();
+            }
+            {
+                std::lock_guard<std::mutex> guard{ s.lock };
+                auto it = s.classes.find(n);
+                if(it != s.classes.end()){
+                    s.remember(kind::clas, detail::key{ n, nullptr, nullptr });
+                    local[n] = detail::local_entry<jclass>{ generation, it->second };
+                    return static_cast<jclass>(env->NewLocalRef(it->second));
+                }
+            }
+            jclass c = resolve();
+            if(c != NULL){
+                std::lock_guard<std::mutex> guard{ s.lock };
+                s.remember(kind::clas, detail::key{ n, nullptr, nullptr });
+                local[n] = detail::local_entry<jclass>{ generation, NULL };
+            }
+            return c;
+        }
+        template<typename Resolve>
+        jmethodID method(char const* clas, char const* name, char const* signature, Resolve&& resolve){
+            auto& s = detail::state::instance();
+            return detail::member(s.methods, kind::method, clas, name, signature, resolve);
+        }
+        template<typename Resolve>
+        jfieldID field(char const* clas, char const* name, char const* signature, Resolve&& resolve){
+            auto& s = detail::state::instance();
+            return detail::member(s.fields, kind::field, clas, name, signature, resolve);
+        }
+
+        // Writes every binding resolved so far. The file is replaced
+        // atomically, so a crash never leaves a truncated profile.
+        inline bool save(char const* path){
+            std::vector<detail::binding> resolved;
+            {
+                auto& s = detail::state::instance();
+                std::lock_guard<std::mutex> guard{ s.lock };
+                resolved = s.resolved;
+            }
+            std::string tmp = std::string{ path } + ".tmp";
+            std::FILE* f = std::fopen(tmp.c_str(), "w");
+            if(f == nullptr) return false;
+            std::fputs("jnipp-warmup 1\n", f);
+            for(auto& b : resolved){
+                if(b.what == kind::clas){
+                    std::fprintf(f, "C\t%s\n", std::get<0>(b.where));
+                }
+                else{
+                    std::fprintf(f, "%c\t%s\t%s\t%s\n", static_cast<char>(b.what),
+                        std::get<0>(b.where), std::get<1>(b.where), std::get<2>(b.where));
+                }
+            }
+            if(std::fclose(f) != 0 || std::rename(tmp.c_str(), path) != 0){
+                std::remove(tmp.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        struct load_result {
+            std::size_t resolved;
+            // Bindings that no longer exist, e.g. after a code change.
+            std::size_t failed;
+        };
+
+        // Resolves every binding in the profile; meant for JNI_OnLoad. A
+        // missing or foreign file resolves nothing. Failures are cleared
+        // and skipped, so a stale profile only costs the failed lookups.
+        inline load_result load(JNIEnv* env, char const* path){
+            load_result r{ 0, 0 };
+            std::ifstream in{ path };
+            std::string line;
+            if(!std::getline(in, line) || line != "jnipp-warmup 1") return r;
+            auto& s = detail::state::instance();
+            auto class_of = [&](char const* n) -> jclass {
+                {
+                    std::lock_guard<std::mutex> guard{ s.lock };
+                    auto it = s.classes.find(n);
+                    if(it != s.classes.end()) return it->second;
+                }
+                jclass local = env->FindClass(n);
+                if(local == NULL) return NULL;
+                auto global = static_cast<jclass>(env->NewGlobalRef(local));
+                env->DeleteLocalRef(local);
+                if(global == NULL) return NULL;
+                std::lock_guard<std::mutex> guard{ s.lock };
+                auto inserted = s.classes.emplace(n, global);
+                if(!inserted.second) env->DeleteGlobalRef(global);
+                return inserted.first->second;
+            };
+            while(std::getline(in, line)){
+                std::vector<std::string> parts;
+                std::size_t begin = 0;
+                for(;;){
+                    auto end = line.find('\t', begin);
+                    parts.push_back(line.substr(begin, end - begin));
+                    if(end == std::string::npos) break;
+                    begin = end + 1;
+                }
+                bool ok = false;
+                if(parts.size() == 2 && parts[0] == "C"){
+                    ok = class_of(names::intern(parts[1].c_str())) != NULL;
+                }
+                else if(parts.size() == 4 && (parts[0] == "M" || parts[0] == "F")){
+                    auto k = detail::intern(parts[1].c_str(), parts[2].c_str(), parts[3].c_str());
+                    jclass c = class_of(std::get<0>(k));
+                    if(c != NULL && parts[0] == "M"){
+                        jmethodID id = env->GetMethodID(c, std::get<1>(k), std::get<2>(k));
+                        std::lock_guard<std::mutex> guard{ s.lock };
+                        if(id != NULL) s.methods.emplace(k, id);
+                        ok = id != NULL;
+                    }
+                    else if(c != NULL){
+                        jfieldID id = env->GetFieldID(c, std::get<1>(k), std::get<2>(k));
+                        std::lock_guard<std::mutex> guard{ s.lock };
+                        if(id != NULL) s.fields.emplace(k, id);
+                        ok = id != NULL;
+                    }
+                }
+                if(ok){
+                    ++r.resolved;
+                }
+                else{
+                    env->ExceptionClear();
+                    ++r.failed;
+                }
+            }
+            s.generation.fetch_add(1, std::memory_order_release);
+            return r;
+        }
+
+        // Drops the warm cache and its global references; for JNI_OnUnload.
+        inline void unload(JNIEnv* env){
+            auto& s = detail::state::instance();
+            std::lock_guard<std::mutex> guard{ s.lock };
+            for(auto& c : s.classes) env->DeleteGlobalRef(c.second);
+            s.classes.clear();
+            s.methods.clear();
+            s.fields.clear();
+            s.generation.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+#endif // JNIPP_JNIPP_WARMUP_HPP
@@ -0,0 +1,130 @@
+//=============================================================================
+//! \file    jnipp/test/check.cpp
+//! \brief   Exception-check policies of method<> and field<>
+//=============================================================================
+#include <cstdint>
+#include <type_traits>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace mock = jnipp::mock;
+
+    struct fixture {
+        mock::jvm m;
+        jclass counter;
+        jobject obj;
+        jmethodID add;
+
+        fixture(){
+            counter = m.define_class("com/example/Counter");
+            add = m.define_method(counter, "add", "(IJ)I", [](mock::jvm&, jobject, jvalue const* a){
+                jvalue r;
+                r.i = a[0].i + static_cast<jint>(a[1].j);
+                return r;
+            });
+            m.define_method(counter, "fail", "()V", [](mock::jvm& v, jobject, jvalue const*){
+                v.throw_new("java/lang/IllegalStateException", "fail");
+                return jvalue{};
+            });
+            m.define_field(counter, "value", "I");
+            m.define_field(counter, "label", "Ljava/lang/String;");
+            m.define_method(counter, "name", "()Ljava/lang/String;", [](mock::jvm& v, jobject, jvalue const*){
+                jvalue r;
+                r.l = v.env()->NewStringUTF("counter");
+                return r;
+            });
+            m.define_method(counter, "values", "(I)[I", [](mock::jvm& v, jobject, jvalue const* a){
+                jvalue r;
+                r.l = v.env()->NewIntArray(a[0].i);
+                return r;
+            });
+            obj = m.new_object(counter);
+        }
+    };
+
+    void immediate(){
+        fixture f;
+        jnipp::environment env{ f.m.env() };
+        auto c = *env.find_class("com/example/Counter");
+        auto add = *c.get_method<std::int32_t(std::int32_t, std::int64_t), jnipp::check::immediate>("add");
+        auto fail = *c.get_method<void(), jnipp::check::immediate>("fail");
+        auto value = *c.get_field<std::int32_t, jnipp::check::immediate>("value");
+        static_assert(std::is_same<decltype(add(f.obj, 1, jlong{ 2 })), jnipp::jni_expected<jint>>::value, "");
+
+        auto sum = add(f.obj, 1, jlong{ 2 });
+        JNIPP_CHECK(sum && *sum == 3);
+        JNIPP_CHECK(value.set(f.obj, 5) && *value.get(f.obj) == 5);
+
+        f.m.reset_counters();
+        auto r = fail(f.obj);
+        JNIPP_CHECK(!r && r.error().has_exception());
+        // The error reuses the check that found the exception.
+        JNIPP_CHECK(f.m.count(mock::function::ExceptionCheck) == 1);
+        f.m.env()->ExceptionClear();
+        JNIPP_CHECK(f.m.invocations(f.add) == 1);
+    }
+
+    void none(){
+        fixture f;
+        jnipp::environment env{ f.m.env() };
+        auto c = *env.find_class("com/example/Counter");
+        auto add = *c.get_method<std::int32_t(std::int32_t, std::int64_t)>("add");
+        auto value = *c.get_field<std::int32_t>("value");
+        static_assert(std::is_same<decltype(add(f.obj, 1, jlong{ 2 })), jint>::value, "");
+
+        f.m.reset_counters();
+        JNIPP_CHECK(add(f.obj, 1, jlong{ 2 }) == 3);
+        value.set(f.obj, 7);
+        JNIPP_CHECK(value.get(f.obj) == 7);
+        JNIPP_CHECK(f.m.count(mock::function::ExceptionCheck) == 0);
+    }
+
+    void scope(){
+        fixture f;
+        jnipp::environment env{ f.m.env() };
+        auto c = *env.find_class("com/example/Counter");
+        auto add = *c.get_method<std::int32_t(std::int32_t, std::int64_t), jnipp::check::deferred>("add");
+        auto fail = *c.get_method<void(), jnipp::check::deferred>("fail");
+
+        jnipp::exception_scope ok{ env };
+        add(f.obj, 1, jlong{ 1 });
+        add(f.obj, 2, jlong{ 2 });
+        JNIPP_CHECK(ok.check());
+
+        jnipp::exception_scope failing{ env };
+        fail(f.obj);
+        auto r = failing.check();
+        JNIPP_CHECK(!r && r.error().has_exception());
+        f.m.env()->ExceptionClear();
+    }
+
+    void references(){
+        fixture f;
+        jnipp::environment env{ f.m.env() };
+        auto c = *env.find_class("com/example/Counter");
+        auto label = c.get_field<::jstring>("label");
+        auto name = c.get_method<::jstring()>("name");
+        auto values = c.get_method<jintArray(std::int32_t), jnipp::check::immediate>("values");
+        JNIPP_CHECK(label && name && values);
+        static_assert(std::is_same<decltype((*name)(f.obj)), ::jstring>::value, "");
+        static_assert(std::is_same<decltype((*values)(f.obj, 3)), jnipp::jni_expected<jintArray>>::value, "");
+
+        auto s = (*name)(f.obj);
+        label->set(f.obj, s);
+        JNIPP_CHECK(label->get(f.obj) == s && f.m.message(reinterpret_cast<jthrowable>(s)) == "counter");
+        auto a = (*values)(f.obj, 3);
+        JNIPP_CHECK(a && f.m.env()->GetArrayLength(*a) == 3);
+        JNIPP_CHECK(!c.get_field<jobject>("label"));
+        f.m.env()->ExceptionClear();
+    }
+}
+
+int main(){
+    immediate();
+    none();
+    scope();
+    references();
+    return jnipp_test::result();
+}
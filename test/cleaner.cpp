@@ -0,0 +1,126 @@
+//=============================================================================
+//! \file    jnipp/test/cleaner.cpp
+//! \brief   cleaner::reaper batching, release<T> and shutdown on the mock
+//=============================================================================
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_cleaner.hpp"
+#include "test.hpp"
+
+namespace {
+    using std::chrono::milliseconds;
+
+    struct peer {
+        static std::atomic<int> alive;
+        static std::atomic<int> off_thread;
+        std::thread::id owner;
+        peer() : owner{ std::this_thread::get_id() } { ++alive; }
+        ~peer(){
+            if(std::this_thread::get_id() != owner) ++off_thread;
+            --alive;
+        }
+    };
+    std::atomic<int> peer::alive{ 0 };
+    std::atomic<int> peer::off_thread{ 0 };
+
+    template<typename F>
+    bool eventually(F f){
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+        while(!f()){
+            if(std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(milliseconds{ 1 });
+        }
+        return true;
+    }
+
+    void batching(){
+        jnipp::mock::jvm m;
+        {
+            // A full batch wakes the reaper long before the interval.
+            auto r = jnipp::cleaner::reaper::start(m.vm(), 4, milliseconds{ 60000 });
+            JNIPP_CHECK(r != nullptr);
+            for(int i = 0; i < 3; ++i){
+                r->retire(std::unique_ptr<peer>{ new peer });
+            }
+            std::this_thread::sleep_for(milliseconds{ 50 });
+            JNIPP_CHECK(r->destroyed() == 0 && r->batch_count() == 0 && peer::alive == 3);
+            r->retire(std::unique_ptr<peer>{ new peer });
+            JNIPP_CHECK(eventually([&]{ return r->destroyed() == 4; }));
+            JNIPP_CHECK(r->batch_count() == 1 && peer::alive == 0 && peer::off_thread == 4);
+            r->retire(std::unique_ptr<peer>{});
+        }
+        {
+            // A partial batch waits for the interval.
+            auto r = jnipp::cleaner::reaper::start(m.vm(), 256, milliseconds{ 200 });
+            r->retire(std::unique_ptr<peer>{ new peer });
+            r->retire(std::unique_ptr<peer>{ new peer });
+            JNIPP_CHECK(eventually([&]{ return r->destroyed() == 2; }));
+            JNIPP_CHECK(r->batch_count() == 1 && peer::alive == 0);
+        }
+    }
+
+    void shutdown(){
+        jnipp::mock::jvm m;
+        peer::off_thread = 0;
+        auto r = jnipp::cleaner::reaper::start(m.vm(), 100, milliseconds{ 60000 });
+        for(int i = 0; i < 5; ++i){
+            r->retire(std::unique_ptr<peer>{ new peer });
+        }
+        JNIPP_CHECK(peer::alive == 5);
+        // Everything still queued is destroyed before the destructor returns.
+        r.reset();
+        JNIPP_CHECK(peer::alive == 0 && peer::off_thread == 5);
+    }
+
+    void release(){
+        jnipp::mock::jvm m;
+        jnipp::handles::registry<peer> peers;
+        auto r = jnipp::cleaner::reaper::start(m.vm(), 1, milliseconds{ 60000 });
+        auto h = peers.insert(std::unique_ptr<peer>{ new peer });
+
+        // Not attached yet: ignored.
+        jnipp::cleaner::release<peer>(m.env(), NULL, h);
+        JNIPP_CHECK(peers.get(h) != nullptr && peer::alive == 1);
+
+        jnipp::cleaner::attach(peers, *r);
+        jnipp::cleaner::release<peer>(m.env(), NULL, h);
+        JNIPP_CHECK(peers.get(h) == nullptr);
+        JNIPP_CHECK(eventually([&]{ return r->destroyed() == 1; }) && peer::alive == 0);
+
+        // close() followed by the Cleaner, then a handle never issued.
+        jnipp::cleaner::release<peer>(m.env(), NULL, h);
+        jnipp::cleaner::release<peer>(m.env(), NULL, 0);
+        jnipp::cleaner::release<peer>(m.env(), NULL, h + 1);
+        auto again = peers.insert(std::unique_ptr<peer>{ new peer });
+        // The slot is reused under a new generation the stale handle misses.
+        jnipp::cleaner::release<peer>(m.env(), NULL, h);
+        JNIPP_CHECK(peers.get(again) != nullptr && peer::alive == 1);
+        std::this_thread::sleep_for(milliseconds{ 20 });
+        JNIPP_CHECK(r->destroyed() == 1 && m.env()->ExceptionCheck() == JNI_FALSE);
+
+        jnipp::cleaner::release<peer>(m.env(), NULL, again);
+        r.reset();
+        JNIPP_CHECK(peer::alive == 0);
+        jnipp::cleaner::binding<peer>::target.store(nullptr);
+    }
+
+    void attach_failure(){
+        jnipp::mock::jvm m;
+        m.fail_attach(true);
+        JNIPP_CHECK(jnipp::cleaner::reaper::start(m.vm()) == nullptr);
+        m.fail_attach(false);
+        JNIPP_CHECK(jnipp::cleaner::reaper::start(m.vm()) != nullptr);
+    }
+}
+
+int main(){
+    batching();
+    shutdown();
+    release();
+    attach_failure();
+    return jnipp_test::result();
+}
@@ -0,0 +1,76 @@
+# Compiles codegen.cpp with -O2 -S and compares every jnipp_<name> function
+# with raw_<name>: the jnipp one may not have more calls, memory operands
+# or allocations. Instruction counts are only reported, since block layout
+# alone can add a jump. x86-64 AT&T assembly, as GCC and Clang emit it.
+#
+#   cmake -DCXX=<compiler> -DSOURCE=<codegen.cpp> -DOUTPUT=<codegen.s>
+#         "-DFLAGS=<flag;...>" -P codegen.cmake
+execute_process(
+    COMMAND ${CXX} ${FLAGS} -O2 -S -fno-asynchronous-unwind-tables -o ${OUTPUT} ${SOURCE}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling ${SOURCE} failed:\n${errors}")
+endif()
+
+file(STRINGS ${OUTPUT} lines)
+set(function "")
+set(names "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^([A-Za-z_][A-Za-z0-9_]*)(\\.cold[.0-9]*)?:")
+        set(function ${CMAKE_MATCH_1})
+        if(NOT DEFINED instructions_${function})
+            list(APPEND names ${function})
+            set(instructions_${function} 0)
+            set(calls_${function} 0)
+            set(memory_${function} 0)
+            set(allocations_${function} 0)
+        endif()
+    elseif(line MATCHES "^[ \t]+\\.size[ \t]")
+        set(function "")
+    elseif(function AND line MATCHES "^[ \t]+([a-z][a-z0-9]*)[ \t]*(.*)$")
+        set(mnemonic ${CMAKE_MATCH_1})
+        set(operands "${CMAKE_MATCH_2}")
+        math(EXPR instructions_${function} "${instructions_${function}} + 1")
+        # Tail calls are jumps out of the function, not to one of its labels.
+        if(mnemonic MATCHES "^call" OR (mnemonic STREQUAL "jmp" AND NOT operands MATCHES "^\\.L"))
+            math(EXPR calls_${function} "${calls_${function}} + 1")
+        endif()
+        if(mnemonic MATCHES "^(call|jmp)" AND operands MATCHES "(_Znw|_Zna|malloc|calloc|realloc)")
+            math(EXPR allocations_${function} "${allocations_${function}} + 1")
+        endif()
+        if(operands MATCHES "\\(" AND NOT mnemonic MATCHES "^(lea|nop)")
+            math(EXPR memory_${function} "${memory_${function}} + 1")
+        endif()
+    endif()
+endforeach()
+
+set(failed FALSE)
+set(compared 0)
+foreach(name IN LISTS names)
+    if(NOT name MATCHES "^jnipp_(.+)$")
+        continue()
+    endif()
+    set(raw raw_${CMAKE_MATCH_1})
+    if(NOT DEFINED instructions_${raw})
+        message(SEND_ERROR "${name} has no ${raw} to compare with")
+        set(failed TRUE)
+        continue()
+    endif()
+    math(EXPR compared "${compared} + 1")
+    set(line "${name}: instructions ${instructions_${name}}/${instructions_${raw}}")
+    foreach(count calls memory allocations)
+        string(APPEND line " ${count} ${${count}_${name}}/${${count}_${raw}}")
+        if(${count}_${name} GREATER ${count}_${raw})
+            set(failed TRUE)
+            string(APPEND line " (more than raw)")
+        endif()
+    endforeach()
+    message(STATUS "${line}")
+endforeach()
+if(compared EQUAL 0)
+    message(FATAL_ERROR "No jnipp_ functions found in ${OUTPUT}")
+endif()
+if(failed)
+    message(FATAL_ERROR "jnipp call sites compile to more than raw JNI; see ${OUTPUT}")
+endif()
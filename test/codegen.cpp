@@ -0,0 +1,84 @@
+//=============================================================================
+//! \file    jnipp/test/codegen.cpp
+//! \brief   Call sites whose optimized code codegen.cmake compares
+//!
+//! Each jnipp_<name> must compile to no more calls, memory operands or
+//! allocations than raw_<name>, the same operation written against the JNI
+//! function table.
+//=============================================================================
+#include <cstdint>
+
+#include <jni.h>
+
+#include "jnipp.hpp"
+
+extern "C" {
+    jint raw_call_int(JNIEnv* env, jmethodID id, jobject obj){
+        return env->CallIntMethod(obj, id);
+    }
+    jint jnipp_call_int(jnipp::method<jint> m, jobject obj){
+        return m(obj);
+    }
+
+    jint raw_call_args(JNIEnv* env, jmethodID id, jobject obj, jint a, jlong b){
+        return env->CallIntMethod(obj, id, a, b);
+    }
+    jint jnipp_call_args(jnipp::method<jint> m, jobject obj, jint a, jlong b){
+        return m(obj, a, b);
+    }
+
+    void raw_call_void(JNIEnv* env, jmethodID id, jobject obj){
+        env->CallVoidMethod(obj, id);
+    }
+    void jnipp_call_void(jnipp::method<void> m, jobject obj){
+        m(obj);
+    }
+
+    jstring raw_call_string(JNIEnv* env, jmethodID id, jobject obj){
+        return static_cast<jstring>(env->CallObjectMethod(obj, id));
+    }
+    jstring jnipp_call_string(jnipp::method<jstring> m, jobject obj){
+        return m(obj);
+    }
+
+    jint raw_call_checked(JNIEnv* env, jmethodID id, jobject obj){
+        jint r = env->CallIntMethod(obj, id);
+        return env->ExceptionCheck() == JNI_TRUE ? -1 : r;
+    }
+    jint jnipp_call_checked(jnipp::method<jint, jnipp::check::immediate> m, jobject obj){
+        return m(obj).value_or(-1);
+    }
+
+    jint raw_get_field(JNIEnv* env, jfieldID id, jobject obj){
+        return env->GetIntField(obj, id);
+    }
+    jint jnipp_get_field(jnipp::field<jint> f, jobject obj){
+        return f.get(obj);
+    }
+
+    void raw_set_field(JNIEnv* env, jfieldID id, jobject obj, jint v){
+        env->SetIntField(obj, id, v);
+    }
+    void jnipp_set_field(jnipp::field<jint> f, jobject obj, jint v){
+        f.set(obj, v);
+    }
+
+    jmethodID raw_get_method(JNIEnv* env, jclass c){
+        return env->GetMethodID(c, "getI", "()I");
+    }
+    jmethodID jnipp_get_method(JNIEnv* env, jclass c){
+        auto m = jnipp::clas{ env, c }.get_method<std::int32_t()>("getI");
+        return m ? m->get() : NULL;
+    }
+
+    // The method ID looked up once and cached, then called.
+    jint raw_cached_call(JNIEnv* env, jclass c, jobject obj){
+        static jmethodID const id = env->GetMethodID(c, "getI", "()I");
+        return env->CallIntMethod(obj, id);
+    }
+    jint jnipp_cached_call(JNIEnv* env, jclass c, jobject obj){
+        static jmethodID const id = jnipp::clas{ env, c }.get_method<std::int32_t()>("getI")
+            .map([](jnipp::method<jint> m){ return m.get(); }).value_or(nullptr);
+        return jnipp::method<jint>{ env, id }(obj);
+    }
+}
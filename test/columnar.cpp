@@ -0,0 +1,96 @@
+//=============================================================================
+//! \file    jnipp/test/columnar.cpp
+//! \brief   columnar column widths, byte columns and the Java round trip
+//=============================================================================
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_columnar.hpp"
+#include "test.hpp"
+
+namespace {
+    using jnipp::columnar::column;
+
+    template<typename T>
+    using plain = column<T, 'v'>;
+
+    // Every arithmetic column keeps its C++ width and names the Java type
+    // of that width.
+    static_assert(std::is_same<plain<std::int8_t>::type, std::int8_t>::value, "");
+    static_assert(std::is_same<plain<std::uint8_t>::type, std::uint8_t>::value, "");
+    static_assert(std::is_same<plain<bool>::type, jboolean>::value, "");
+
+    using bytes = jnipp::columnar::schema<
+        column<std::int8_t, 's','i','g','n','e','d'>,
+        column<std::uint8_t, 'u','n','s','i','g','n','e','d'>,
+        column<char, 'l','e','t','t','e','r'>,
+        column<bool, 'f','l','a','g'>,
+        column<std::uint16_t, 'u','n','i','t'>>;
+
+    void signatures(){
+        JNIPP_CHECK(std::string{ plain<bool>::signature::str } == "Z");
+        JNIPP_CHECK(std::string{ plain<char>::signature::str } == "B");
+        JNIPP_CHECK(std::string{ plain<std::int8_t>::signature::str } == "B");
+        JNIPP_CHECK(std::string{ plain<std::uint8_t>::signature::str } == "B");
+        JNIPP_CHECK(std::string{ plain<std::int16_t>::signature::str } == "S");
+        JNIPP_CHECK(std::string{ plain<std::uint16_t>::signature::str } == "C");
+        JNIPP_CHECK(std::string{ plain<std::int32_t>::signature::str } == "I");
+        JNIPP_CHECK(std::string{ plain<std::uint32_t>::signature::str } == "I");
+        JNIPP_CHECK(std::string{ plain<std::int64_t>::signature::str } == "J");
+        JNIPP_CHECK(std::string{ plain<std::uint64_t>::signature::str } == "J");
+        JNIPP_CHECK(std::string{ plain<float>::signature::str } == "F");
+        JNIPP_CHECK(std::string{ plain<double>::signature::str } == "D");
+
+        auto source = bytes::java_source("com.example", "Bytes");
+        JNIPP_CHECK(source.find("TYPES = { \"B\", \"B\", \"B\", \"Z\", \"C\" }") != std::string::npos);
+    }
+
+    void byte_columns(){
+        jnipp::columnar::batch<bytes> b{ 4 };
+        b.append(std::int8_t{ -128 }, std::uint8_t{ 255 }, 'a', true, std::uint16_t{ 65535 });
+        b.append(jnipp::columnar::null, std::uint8_t{ 1 }, jnipp::columnar::null, false, std::uint16_t{ 7 });
+        b.append(std::int8_t{ 127 }, jnipp::columnar::null, 'z', jnipp::columnar::null, jnipp::columnar::null);
+
+        auto s = b.column<0>();
+        auto u = b.column<1>();
+        auto c = b.column<2>();
+        auto f = b.column<3>();
+        auto w = b.column<4>();
+        JNIPP_CHECK(s.size() == 3 && s[0] == -128 && !s.valid(1) && s[1] == 0 && s[2] == 127);
+        JNIPP_CHECK(u[0] == 255 && u[1] == 1 && !u.valid(2));
+        JNIPP_CHECK(c[0] == 'a' && !c.valid(1) && c[2] == 'z');
+        JNIPP_CHECK(f[0] == JNI_TRUE && f[1] == JNI_FALSE && f.valid(1) && !f.valid(2));
+        JNIPP_CHECK(w[0] == 65535 && w[1] == 7 && !w.valid(2));
+
+        jnipp::mock::jvm m;
+        m.define_class("java/nio/ByteBuffer");
+        auto a = b.to_java(m.env());
+        JNIPP_CHECK(a && m.env()->GetArrayLength(*a) == static_cast<jsize>(bytes::buffers));
+        // One byte a row, as Java's byte and boolean.
+        for(std::size_t column = 0; column < 4; ++column){
+            jobject values = m.env()->GetObjectArrayElement(*a, static_cast<jsize>(bytes::first_buffer(column) + 1));
+            JNIPP_CHECK(m.env()->GetDirectBufferCapacity(values) == 3);
+            m.env()->DeleteLocalRef(values);
+        }
+        jobject units = m.env()->GetObjectArrayElement(*a, static_cast<jsize>(bytes::first_buffer(4) + 1));
+        JNIPP_CHECK(m.env()->GetDirectBufferCapacity(units) == 6);
+        m.env()->DeleteLocalRef(units);
+
+        auto v = bytes::from_java(m.env(), 3, *a);
+        JNIPP_CHECK(v && std::get<0>(*v)[0] == -128 && std::get<1>(*v)[0] == 255 && std::get<2>(*v)[2] == 'z');
+        JNIPP_CHECK(std::get<4>(*v)[0] == 65535);
+        auto short_of_rows = bytes::from_java(m.env(), 4, *a);
+        JNIPP_CHECK(!short_of_rows);
+        m.env()->DeleteLocalRef(*a);
+    }
+}
+
+int main(){
+    signatures();
+    byte_columns();
+    return jnipp_test::result();
+}
@@ -0,0 +1,31 @@
+# Builds and runs the tests again in another configuration, e.g. Release,
+# whose optimizer reports warnings the default build does not, or with a
+# sanitizer given in FLAGS.
+#
+#   cmake -DSOURCE=<project dir> -DBINARY=<build dir> -DCONFIG=<type>
+#         -DCXX=<compiler> [-DFLAGS=<compiler flags>] -P configuration.cmake
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -S ${SOURCE} -B ${BINARY} -DCMAKE_BUILD_TYPE=${CONFIG}
+        -DCMAKE_CXX_COMPILER=${CXX} "-DCMAKE_CXX_FLAGS=${FLAGS}" -DJNIPP_TEST_CONFIGURATIONS=OFF
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Configuring ${CONFIG} failed:\n${output}")
+endif()
+execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${BINARY} --config ${CONFIG}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Building ${CONFIG} failed:\n${output}")
+endif()
+execute_process(
+    COMMAND ${CMAKE_CTEST_COMMAND} --test-dir ${BINARY} -C ${CONFIG} --output-on-failure
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Tests failed in ${CONFIG}:\n${output}")
+endif()
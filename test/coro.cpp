@@ -0,0 +1,89 @@
+//=============================================================================
+//! \file    jnipp/test/coro.cpp
+//! \brief   coro::worker calls, results and captured Java exceptions
+//=============================================================================
+#include <cstdint>
+#include <latch>
+#include <string>
+#include <thread>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_coro.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace mock = jnipp::mock;
+
+    struct task {
+        struct promise_type {
+            task get_return_object(){ return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void(){}
+            void unhandled_exception(){ std::terminate(); }
+        };
+    };
+
+    task calls(mock::jvm& m, jnipp::coro::worker& w, jnipp::clas c, jobject o, std::latch& done){
+        auto add = *c.get_method<std::int32_t(std::int32_t, std::int32_t)>("add");
+        auto boom = *c.get_method<void(), jnipp::check::immediate>("boom");
+        auto name = *c.get_method<::jstring()>("name");
+        auto main = std::this_thread::get_id();
+
+        auto r = co_await jnipp::coro::invoke(w, add, o, jint{ 2 }, jint{ 3 });
+        JNIPP_CHECK(r && *r == 5 && std::this_thread::get_id() != main);
+
+        auto b = co_await jnipp::coro::invoke(w, boom, o);
+        JNIPP_CHECK(!b && b.error().has_exception());
+        JNIPP_CHECK(b.error().describe().find("java.lang.IllegalStateException: boom") != std::string::npos);
+        JNIPP_CHECK(m.class_name(b.error().get_exception()) == "java/lang/IllegalStateException");
+        {
+            // Copies share the reference; the last one deletes it.
+            auto globals = m.global_refs();
+            auto copy = b;
+            b = jnipp::coro::expected<void>{};
+            JNIPP_CHECK(copy.error().has_exception() && m.global_refs() == globals);
+        }
+
+        auto s = co_await jnipp::coro::invoke(w, name, o);
+        JNIPP_CHECK(s && m.message(reinterpret_cast<jthrowable>(*s)) == "foo");
+        m.env()->DeleteGlobalRef(*s);
+        done.count_down();
+    }
+
+    void worker(){
+        mock::jvm m;
+        jclass foo = m.define_class("com/example/Foo");
+        m.define_method(foo, "add", "(II)I", [](mock::jvm&, jobject, jvalue const* a){
+            jvalue r;
+            r.i = a[0].i + a[1].i;
+            return r;
+        });
+        m.define_method(foo, "boom", "()V", [](mock::jvm& v, jobject, jvalue const*){
+            v.throw_new("java/lang/IllegalStateException", "boom");
+            return jvalue{};
+        });
+        m.define_method(foo, "name", "()Ljava/lang/String;", [](mock::jvm& v, jobject, jvalue const*){
+            jvalue r;
+            r.l = v.env()->NewStringUTF("foo");
+            return r;
+        });
+        jobject o = m.env()->NewGlobalRef(m.new_object(foo));
+        jnipp::environment env{ m.env() };
+        auto c = *env.find_class("com/example/Foo");
+        auto globals = m.global_refs();
+        std::latch done{ 1 };
+        {
+            auto w = jnipp::coro::worker::start(m.vm());
+            JNIPP_CHECK(w != nullptr);
+            calls(m, *w, c, o, done);
+            done.wait();
+        }
+        JNIPP_CHECK(m.env()->ExceptionCheck() == JNI_FALSE && m.global_refs() == globals);
+    }
+}
+
+int main(){
+    worker();
+    return jnipp_test::result();
+}
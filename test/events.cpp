@@ -0,0 +1,117 @@
+//=============================================================================
+//! \file    jnipp/test/events.cpp
+//! \brief   events::queue and pump delivery, wakeups and startup failure
+//=============================================================================
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_events.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace mock = jnipp::mock;
+
+    struct tick {
+        jlong time;
+        jdouble price;
+    };
+    using ticks = jnipp::events::pump<tick, 1 << 10,
+        JNIPP_SOA_FIELD(tick, time), JNIPP_SOA_FIELD(tick, price)>;
+
+    std::atomic<long long> total{ 0 };
+    std::atomic<long long> received{ 0 };
+    std::atomic<int> torn{ 0 };
+
+    struct fixture {
+        mock::jvm m;
+        jobject listener;
+        jnipp::method<void> on_ticks{ nullptr, nullptr };
+
+        fixture(){
+            jclass c = m.define_class("com/example/Listener");
+            m.define_method(c, "onTicks", "(I[J[D)V", [](mock::jvm& v, jobject, jvalue const* a){
+                jint n = a[0].i;
+                std::vector<jlong> t(n);
+                std::vector<jdouble> p(n);
+                v.env()->GetLongArrayRegion(static_cast<jlongArray>(a[1].l), 0, n, t.data());
+                v.env()->GetDoubleArrayRegion(static_cast<jdoubleArray>(a[2].l), 0, n, p.data());
+                for(jint i = 0; i < n; ++i){
+                    total += t[i];
+                    if(p[i] != static_cast<double>(t[i]) * 0.5) ++torn;
+                }
+                received += n;
+                return jvalue{};
+            });
+            listener = m.env()->NewGlobalRef(m.new_object(c));
+            jnipp::clas k{ m.env(), c };
+            on_ticks = *k.get_method<ticks::signature>("onTicks");
+        }
+    };
+
+    void queue(){
+        jnipp::events::queue<int, 4> q;
+        int x = 0;
+        JNIPP_CHECK(!q.ready() && !q.pop(x));
+        for(int i = 0; i < 4; ++i) JNIPP_CHECK(q.push(i));
+        JNIPP_CHECK(!q.push(9) && q.dropped() == 1);
+        JNIPP_CHECK(q.ready() && q.pop(x) && x == 0 && q.push(4));
+    }
+
+    void delivery(){
+        fixture f;
+        total = 0;
+        received = 0;
+        {
+            auto p = ticks::start(f.m.vm(), f.listener, f.on_ticks, 64);
+            JNIPP_CHECK(p != nullptr);
+            std::vector<std::thread> producers;
+            for(int t = 0; t < 4; ++t){
+                producers.emplace_back([&p, t]{
+                    for(int i = 1; i <= 500; ++i){
+                        jlong v = t * 1000 + i;
+                        while(!p->push(tick{ v, static_cast<double>(v) * 0.5 })) std::this_thread::yield();
+                    }
+                });
+            }
+            for(auto& t : producers) t.join();
+        }
+        long long expect = 0;
+        for(int t = 0; t < 4; ++t) for(int i = 1; i <= 500; ++i) expect += t * 1000 + i;
+        JNIPP_CHECK(received == 2000 && total == expect && torn == 0);
+    }
+
+    void wakeup(){
+        fixture f;
+        received = 0;
+        auto p = ticks::start(f.m.vm(), f.listener, f.on_ticks, 64);
+        JNIPP_CHECK(p != nullptr);
+        // The idle drainer is parked; a single push must wake it.
+        for(int round = 0; round < 3; ++round){
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+            JNIPP_CHECK(p->push(tick{ 1, 0.5 }));
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+            while(received != round + 1 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+            JNIPP_CHECK(received == round + 1 && p->delivered() == static_cast<std::uint64_t>(round + 1));
+        }
+    }
+
+    void allocation_failure(){
+        fixture f;
+        f.m.fail_allocations(true);
+        auto p = ticks::start(f.m.vm(), f.listener, f.on_ticks, 64);
+        JNIPP_CHECK(p == nullptr);
+        JNIPP_CHECK(f.m.env()->ExceptionCheck() == JNI_FALSE && f.m.global_refs() == 1);
+    }
+}
+
+int main(){
+    queue();
+    delivery();
+    wakeup();
+    allocation_failure();
+    return jnipp_test::result();
+}
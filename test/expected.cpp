@@ -0,0 +1,242 @@
+//=============================================================================
+//! \file    jnipp/test/expected.cpp
+//! \brief   ornew::storage, ornew::expected and jni_error
+//=============================================================================
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    using expected_int = ornew::expected<int, ornew::error::runtime_error>;
+    using expected_string = ornew::expected<std::string, ornew::error::runtime_error>;
+
+    static_assert(std::is_trivially_copyable<ornew::storage<int>>::value, "");
+    static_assert(sizeof(ornew::storage<int>) == sizeof(int), "");
+    static_assert(!std::is_trivially_copyable<ornew::storage<std::string>>::value, "");
+    static_assert(std::is_trivially_copyable<expected_int>::value, "");
+    static_assert(std::is_trivially_copyable<jnipp::jni_expected<jnipp::clas>>::value, "");
+
+    // Every storage operation, one bit each for whether it is noexcept. It
+    // only compiles if S has them all.
+    template<typename S, typename T = typename S::type>
+    constexpr unsigned long operations(){
+        return
+            static_cast<unsigned long>(noexcept(S{ nullptr })) << 0 |
+            static_cast<unsigned long>(noexcept(S{ std::declval<S const&>() })) << 1 |
+            static_cast<unsigned long>(noexcept(S{ std::declval<S&&>() })) << 2 |
+            static_cast<unsigned long>(noexcept(S{ std::declval<T const&>() })) << 3 |
+            static_cast<unsigned long>(noexcept(S{ std::declval<T&&>() })) << 4 |
+            static_cast<unsigned long>(noexcept(S{ ornew::constructor, std::declval<T const&>() })) << 5 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().~S())) << 6 |
+            static_cast<unsigned long>(noexcept(std::declval<S const&>().raw())) << 7 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().raw())) << 8 |
+            static_cast<unsigned long>(noexcept(std::declval<S const&>().constructed())) << 9 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().construct(std::declval<T const&>()))) << 10 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().destruct())) << 11 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().assign(std::declval<T const&>()))) << 12 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().assign(std::declval<T&&>()))) << 13 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>() = std::declval<S const&>())) << 14 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>() = std::declval<S&&>())) << 15 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>() = std::declval<T const&>())) << 16 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>() = std::declval<T&&>())) << 17 |
+            static_cast<unsigned long>(noexcept(std::declval<S&>().operator->())) << 18;
+    }
+    // What the operations return, with S itself standing for the storage.
+    template<typename S, typename T = typename S::type>
+    using results = std::tuple<
+        decltype(std::declval<S const&>().raw()),
+        decltype(std::declval<S&>().raw()),
+        decltype(std::declval<S const&>().constructed()),
+        typename std::is_same<decltype(std::declval<S&>().construct(std::declval<T const&>())), S const&>::type,
+        decltype(std::declval<S&>().destruct()),
+        decltype(std::declval<S&>().assign(std::declval<T const&>())),
+        typename std::is_same<decltype(std::declval<S&>() = std::declval<S const&>()), S&>::type,
+        typename std::is_same<decltype(std::declval<S&>() = std::declval<S&&>()), S&>::type,
+        decltype(std::declval<S&>() = std::declval<T const&>()),
+        decltype(std::declval<S&>().operator->())>;
+
+    // The trivial specialization against the generic one for the same type.
+    template<typename T>
+    struct same_storage
+        : std::integral_constant<bool,
+            operations<ornew::storage<T, false>>() == operations<ornew::storage<T, true>>() &&
+            std::is_same<results<ornew::storage<T, false>>, results<ornew::storage<T, true>>>::value> {
+    };
+    struct point {
+        float x;
+        float y;
+    };
+    static_assert(same_storage<int>::value, "");
+    static_assert(same_storage<double>::value, "");
+    static_assert(same_storage<point>::value, "");
+    static_assert(same_storage<jnipp::clas>::value, "");
+    static_assert(operations<ornew::storage<int>>() == (1ul << 19) - 1, "Trivial storage never throws.");
+
+    expected_int parse(int v){
+        if(v < 0) return ornew::raise<ornew::error::runtime_error>("negative");
+        return v;
+    }
+
+    void storage(){
+        ornew::storage<std::string> a{ nullptr };
+        JNIPP_CHECK(!a.constructed());
+        a = std::string(40, 'x');
+        JNIPP_CHECK(a.constructed() && *a.raw() == std::string(40, 'x'));
+        auto b = a;
+        auto c = std::move(a);
+        JNIPP_CHECK(*b.raw() == *c.raw());
+        b.destruct();
+        JNIPP_CHECK(!b.constructed());
+        c = b;
+        JNIPP_CHECK(!c.constructed());
+
+        ornew::storage<int> i{ 7 };
+        auto j = i;
+        JNIPP_CHECK(*j.raw() == 7);
+    }
+
+    void expected(){
+        auto ok = parse(3);
+        auto bad = parse(-1);
+        JNIPP_CHECK(ok && ok.has_value() && *ok == 3 && ok.value() == 3);
+        JNIPP_CHECK(!bad && std::string{ bad.error().get_message() } == "negative");
+        JNIPP_CHECK(bad.value_or(9) == 9 && ok.value_or(9) == 3);
+
+        auto doubled = ok.map([](int v){ return v * 2; });
+        JNIPP_CHECK(doubled && *doubled == 6);
+        auto chained = ok.and_then([](int v){ return parse(v - 10); });
+        JNIPP_CHECK(!chained && std::string{ chained.error().get_message() } == "negative");
+        auto recovered = bad.or_else([](ornew::error::runtime_error const&) -> expected_int { return 0; });
+        JNIPP_CHECK(recovered && *recovered == 0);
+
+        expected_string s{ std::string(64, 'y') };
+        auto t = s;
+        t = std::move(s);
+        JNIPP_CHECK(t && t->size() == 64);
+
+        ornew::expected<void, ornew::error::runtime_error> done;
+        ornew::expected<void, ornew::error::runtime_error> failed = ornew::raise<ornew::error::runtime_error>("failed");
+        JNIPP_CHECK(done && !failed);
+        JNIPP_CHECK(done.and_then([]{ return parse(1); }).value_or(0) == 1);
+        JNIPP_CHECK(!failed.and_then([]{ return parse(1); }));
+    }
+
+    // Copies throw on request; counts the objects alive.
+    struct fragile {
+        static int alive;
+        bool throws;
+        explicit fragile(bool throws) : throws{ throws } { ++alive; }
+        fragile(fragile const& a) : throws{ a.throws } {
+            if(throws) throw std::runtime_error("copy");
+            ++alive;
+        }
+        fragile(fragile&& a) noexcept : throws{ a.throws } { ++alive; }
+        fragile& operator=(fragile const&) = default;
+        ~fragile(){ --alive; }
+    };
+    int fragile::alive = 0;
+    using expected_fragile = ornew::expected<fragile, ornew::error::runtime_error>;
+
+    void throwing_assignment(){
+        {
+            expected_fragile good{ fragile{ true } };
+            expected_fragile bad = ornew::raise<ornew::error::runtime_error>("kept");
+            bool threw = false;
+            try{
+                bad = good;
+            }catch(std::runtime_error const&){
+                threw = true;
+            }
+            // The error survives a copy that throws, and nothing leaked.
+            JNIPP_CHECK(threw && !bad && std::string{ bad.error().get_message() } == "kept");
+            JNIPP_CHECK(fragile::alive == 1);
+
+            expected_fragile other{ fragile{ false } };
+            bad = other;
+            JNIPP_CHECK(bad && fragile::alive == 3);
+            bad = ornew::raise<ornew::error::runtime_error>("again");
+            JNIPP_CHECK(!bad && fragile::alive == 2);
+            bad = std::move(good);
+            JNIPP_CHECK(bad && bad->throws);
+        }
+        JNIPP_CHECK(fragile::alive == 0);
+    }
+
+    void jni_error(){
+        jnipp::mock::jvm m;
+        jnipp::environment env{ m.env() };
+
+        jnipp::jni_error quiet{ m.env(), "quiet" };
+        JNIPP_CHECK(!quiet.has_exception() && quiet.get_exception() == NULL);
+        JNIPP_CHECK(quiet.describe() == "quiet");
+
+        auto missing = env.find_class("com/example/Missing");
+        JNIPP_CHECK(!missing && missing.error().has_exception());
+        auto description = missing.error().describe();
+        JNIPP_CHECK(description.find("find_class") != std::string::npos);
+        JNIPP_CHECK(description.find("java.lang.NoClassDefFoundError: com/example/Missing") != std::string::npos);
+        // describe() leaves the exception pending, as it found it.
+        JNIPP_CHECK(m.env()->ExceptionCheck() == JNI_TRUE);
+        JNIPP_CHECK(m.class_name(m.exception()) == "java/lang/NoClassDefFoundError");
+        m.env()->ExceptionClear();
+    }
+
+    // describe() prints the stack trace through StringWriter and stops at
+    // the first lookup that fails, falling back on toString().
+    void stack_trace(){
+        jnipp::mock::jvm m;
+        jclass writer = m.define_class("java/io/StringWriter");
+        jclass printer = m.define_class("java/io/PrintWriter");
+        jclass failure = m.define_class("com/example/Failure");
+        m.define_method(writer, "<init>", "()V", [](jnipp::mock::jvm&, jobject, jvalue const*){ return jvalue{}; });
+        auto raise = [&]{
+            m.throw_new("com/example/Failure", "broken");
+            return jnipp::jni_error{ m.env(), "failed" };
+        };
+
+        // PrintWriter(Writer) is missing; the third lookup is the toString()
+        // fallback.
+        auto e = raise();
+        auto locals = m.local_refs();
+        m.reset_counters();
+        JNIPP_CHECK(e.describe() == "failed\ncom.example.Failure: broken");
+        JNIPP_CHECK(m.count(jnipp::mock::function::GetMethodID) == 3 && m.count(jnipp::mock::function::NewObject) == 0);
+        JNIPP_CHECK(m.class_name(m.exception()) == "com/example/Failure" && m.local_refs() == locals);
+        m.env()->ExceptionClear();
+
+        // printStackTrace is missing.
+        m.define_method(printer, "<init>", "(Ljava/io/Writer;)V", [](jnipp::mock::jvm&, jobject, jvalue const*){ return jvalue{}; });
+        e = raise();
+        m.reset_counters();
+        JNIPP_CHECK(e.describe() == "failed\ncom.example.Failure: broken");
+        JNIPP_CHECK(m.count(jnipp::mock::function::GetMethodID) == 4 && m.count(jnipp::mock::function::NewObject) == 0);
+        JNIPP_CHECK(m.class_name(m.exception()) == "com/example/Failure");
+        m.env()->ExceptionClear();
+
+        m.define_method(failure, "printStackTrace", "(Ljava/io/PrintWriter;)V",
+            [](jnipp::mock::jvm&, jobject, jvalue const*){ return jvalue{}; });
+        m.define_method(writer, "toString", "()Ljava/lang/String;", [](jnipp::mock::jvm& v, jobject, jvalue const*){
+            jvalue r;
+            r.l = v.env()->NewStringUTF("com.example.Failure: broken\n\tat Example.run");
+            return r;
+        });
+        e = raise();
+        JNIPP_CHECK(e.describe() == "failed\ncom.example.Failure: broken\n\tat Example.run");
+        JNIPP_CHECK(m.class_name(m.exception()) == "com/example/Failure");
+        m.env()->ExceptionClear();
+    }
+}
+
+int main(){
+    storage();
+    expected();
+    throwing_assignment();
+    jni_error();
+    stack_trace();
+    return jnipp_test::result();
+}
@@ -0,0 +1,87 @@
+//=============================================================================
+//! \file    jnipp/test/handles.cpp
+//! \brief   handles::registry generations, reuse and concurrent use
+//=============================================================================
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_handles.hpp"
+#include "test.hpp"
+
+namespace {
+    struct peer {
+        static std::atomic<int> alive;
+        int v;
+        explicit peer(int v) : v{ v } { ++alive; }
+        ~peer(){ --alive; }
+    };
+    std::atomic<int> peer::alive{ 0 };
+
+    void generations(){
+        {
+            jnipp::handles::registry<peer> r;
+            JNIPP_CHECK(r.get(0) == nullptr && r.get(-1) == nullptr && r.get(12345) == nullptr);
+            auto a = r.insert(std::unique_ptr<peer>{ new peer{ 1 } });
+            JNIPP_CHECK(a != 0 && r.get(a)->v == 1 && r.at(a).v == 1);
+            auto p = r.release(a);
+            JNIPP_CHECK(p && p->v == 1 && !r.release(a) && r.get(a) == nullptr);
+
+            bool threw = false;
+            try{
+                r.at(a);
+            }catch(std::invalid_argument const&){
+                threw = true;
+            }
+            JNIPP_CHECK(threw);
+
+            // The slot is reused under a new generation.
+            auto b = r.insert(std::unique_ptr<peer>{ new peer{ 2 } });
+            JNIPP_CHECK(static_cast<std::uint32_t>(b) == static_cast<std::uint32_t>(a) && b != a);
+            JNIPP_CHECK(r.get(a) == nullptr && r.get(b)->v == 2);
+
+            jnipp::mock::jvm m;
+            int v = jnipp::native_entry(m.env(), [&]{ return r.at(a).v; });
+            JNIPP_CHECK(v == 0 && m.class_name(m.exception()) == "java/lang/IllegalArgumentException");
+            m.env()->ExceptionClear();
+            r.insert(std::unique_ptr<peer>{ new peer{ 3 } });
+        }
+        JNIPP_CHECK(peer::alive == 0);
+    }
+
+    void threads(){
+        {
+            jnipp::handles::registry<peer> r;
+            std::atomic<int> bad{ 0 };
+            std::vector<std::thread> ts;
+            for(int t = 0; t < 4; ++t){
+                ts.emplace_back([&, t]{
+                    std::vector<jlong> mine;
+                    for(int i = 0; i < 10000; ++i){
+                        auto h = r.insert(std::unique_ptr<peer>{ new peer{ t * 100000 + i } });
+                        mine.push_back(h);
+                        if(r.get(h)->v != t * 100000 + i) ++bad;
+                        if(i % 3 == 0){
+                            auto old = mine[mine.size() / 2];
+                            if(r.release(old) && r.get(old) != nullptr) ++bad;
+                        }
+                        r.get(h ^ (jlong{ 2 } << 32));
+                    }
+                });
+            }
+            for(auto& t : ts) t.join();
+            JNIPP_CHECK(bad == 0);
+        }
+        JNIPP_CHECK(peer::alive == 0);
+    }
+}
+
+int main(){
+    generations();
+    threads();
+    return jnipp_test::result();
+}
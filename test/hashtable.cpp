@@ -0,0 +1,88 @@
+//=============================================================================
+//! \file    jnipp/test/hashtable.cpp
+//! \brief   hashtable::view lookups, erasure and concurrent writers
+//=============================================================================
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_hashtable.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace ht = jnipp::hashtable;
+
+    struct key3 {
+        std::int32_t a, b, c;
+    };
+    struct pair {
+        std::int64_t x, y;
+    };
+
+    void single(){
+        jnipp::mock::jvm m;
+        ht::buffer<key3, double> b{ 5 };
+        auto& t = b.get();
+        JNIPP_CHECK(t && t.capacity() == 8);
+        double d = 0;
+        JNIPP_CHECK(!t.find(key3{ 1, 2, 3 }, d));
+        for(int i = 0; i < 8; ++i){
+            JNIPP_CHECK(t.assign(key3{ i, i, i }, i * 1.5));
+        }
+        JNIPP_CHECK(!t.assign(key3{ 9, 9, 9 }, 1.0));
+        JNIPP_CHECK(t.assign(key3{ 3, 3, 3 }, 7.0) && t.find(key3{ 3, 3, 3 }, d) && d == 7.0);
+        JNIPP_CHECK(t.erase(key3{ 3, 3, 3 }) && !t.erase(key3{ 3, 3, 3 }) && !t.find(key3{ 3, 3, 3 }, d));
+        JNIPP_CHECK(t.assign(key3{ 3, 3, 3 }, 8.0) && t.find(key3{ 3, 3, 3 }, d) && d == 8.0);
+
+        auto java = ht::to_java(m.env(), t);
+        JNIPP_CHECK(java);
+        auto v = ht::from_java<key3, double>(m.env(), *java);
+        JNIPP_CHECK(v && v->find(key3{ 5, 5, 5 }, d) && d == 7.5);
+        // A table of other key or value sizes is rejected.
+        JNIPP_CHECK((!ht::from_java<std::int64_t, double>(m.env(), *java)));
+        m.env()->ExceptionClear();
+    }
+
+    void threads(){
+        ht::buffer<std::int64_t, pair> b{ 1 << 12 };
+        auto& t = b.get();
+        const std::int64_t keys = 1000;
+        std::atomic<int> torn{ 0 };
+        std::atomic<int> failed{ 0 };
+        std::vector<std::thread> writers;
+        for(int w = 0; w < 2; ++w){
+            writers.emplace_back([&, w]{
+                for(int r = 0; r < 20; ++r){
+                    for(std::int64_t k = 0; k < keys; ++k){
+                        std::int64_t v = k * 1000 + r * 2 + w;
+                        if(!t.assign(k, pair{ v, -v })) ++failed;
+                        if(k % 7 == 0 && r % 5 == 0) t.erase(k);
+                    }
+                }
+            });
+        }
+        std::thread reader{ [&]{
+            for(int r = 0; r < 20; ++r){
+                for(std::int64_t k = 0; k < keys; ++k){
+                    pair p;
+                    if(t.find(k, p) && (p.x != -p.y || p.x / 1000 != k)) ++torn;
+                }
+            }
+        } };
+        for(auto& w : writers) w.join();
+        reader.join();
+        JNIPP_CHECK(torn == 0 && failed == 0);
+        for(std::int64_t k = 1; k < keys; ++k){
+            pair p;
+            if(k % 7 != 0) JNIPP_CHECK(t.find(k, p) && p.x / 1000 == k);
+        }
+    }
+}
+
+int main(){
+    single();
+    threads();
+    return jnipp_test::result();
+}
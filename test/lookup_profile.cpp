@@ -0,0 +1,107 @@
+//=============================================================================
+//! \file    jnipp/test/lookup_profile.cpp
+//! \brief   lookup_profile windows, counts and ordering of lookups
+//=============================================================================
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace profile = jnipp::lookup_profile;
+
+    profile::lookup const* find(std::vector<profile::lookup> const& v, profile::kind what,
+            std::string const& clas, std::string const& name){
+        for(auto& x : v){
+            if(x.what == what && clas == x.clas && name == x.name) return &x;
+        }
+        return nullptr;
+    }
+
+    struct fixture {
+        jnipp::mock::jvm m;
+        fixture(){
+            jclass a = m.define_class("com/example/A");
+            jclass b = m.define_class("com/example/B");
+            m.define_method(a, "f", "(I)I", [](jnipp::mock::jvm&, jobject, jvalue const* v){
+                return v[0];
+            });
+            m.define_field(b, "x", "J");
+        }
+        // Two lookups of A, one of A.f, one of B and three of B.x.
+        void lookups(){
+            jnipp::environment env{ m.env() };
+            auto a = env.find_class("com/example/A");
+            JNIPP_CHECK(a && env.find_class("com/example/A"));
+            JNIPP_CHECK(a && a->get_method<std::int32_t(std::int32_t)>("f"));
+            auto b = env.find_class("com/example/B");
+            for(int i = 0; i < 3; ++i){
+                JNIPP_CHECK(b && b->get_field<std::int64_t>("x"));
+            }
+        }
+    };
+
+    void window(){
+        fixture f;
+        f.lookups();
+        JNIPP_CHECK(!profile::active() && profile::by_lookup().empty());
+
+        profile::start(std::chrono::minutes{ 1 });
+        JNIPP_CHECK(profile::active());
+        f.lookups();
+        auto v = profile::by_lookup();
+        JNIPP_CHECK(v.size() == 4);
+        auto a = find(v, profile::kind::clas, "com/example/A", "");
+        auto m = find(v, profile::kind::method, "com/example/A", "f");
+        auto b = find(v, profile::kind::clas, "com/example/B", "");
+        auto x = find(v, profile::kind::field, "com/example/B", "x");
+        JNIPP_CHECK(a && a->count == 2 && m && m->count == 1 && b && b->count == 1 && x && x->count == 3);
+        JNIPP_CHECK(m && std::string{ m->signature } == "(I)I" && x && std::string{ x->signature } == "J");
+        // first_ns follows the order of the first lookups.
+        JNIPP_CHECK(a && m && b && x && a->first_ns <= m->first_ns && m->first_ns <= b->first_ns &&
+            b->first_ns <= x->first_ns);
+        for(auto& l : v){
+            JNIPP_CHECK(l.max_ns <= l.total_ns && l.max_ns * l.count >= l.total_ns);
+        }
+        for(std::size_t i = 1; i < v.size(); ++i){
+            JNIPP_CHECK(v[i - 1].total_ns >= v[i].total_ns);
+        }
+        auto c = profile::by_class();
+        JNIPP_CHECK(c.size() == 2);
+        for(auto& k : c){
+            JNIPP_CHECK(k.lookups == (std::string{ k.clas } == "com/example/A" ? 3u : 4u));
+        }
+
+        // Nothing is recorded after stop(); the results stay readable.
+        profile::stop();
+        f.lookups();
+        auto after = profile::by_lookup();
+        JNIPP_CHECK(!profile::active() && after.size() == 4);
+        x = find(after, profile::kind::field, "com/example/B", "x");
+        JNIPP_CHECK(x && x->count == 3);
+    }
+
+    void deadline(){
+        fixture f;
+        // The window closes at the first lookup that ends after it.
+        profile::start(std::chrono::nanoseconds{ 0 });
+        f.lookups();
+        JNIPP_CHECK(!profile::active() && profile::by_lookup().empty());
+
+        // start() clears the previous window.
+        profile::start(std::chrono::minutes{ 1 });
+        JNIPP_CHECK(profile::by_lookup().empty());
+        f.lookups();
+        JNIPP_CHECK(profile::by_lookup().size() == 4);
+        profile::stop();
+    }
+}
+
+int main(){
+    window();
+    deadline();
+    return jnipp_test::result();
+}
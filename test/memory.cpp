@@ -0,0 +1,133 @@
+//=============================================================================
+//! \file    jnipp/test/memory.cpp
+//! \brief   memory thresholds and pressure_hook delivery to a Java listener
+//=============================================================================
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace memory = jnipp::memory;
+    using std::chrono::milliseconds;
+
+    constexpr auto mine = static_cast<memory::category>(memory::user);
+    constexpr auto other = static_cast<memory::category>(memory::user + 1);
+
+    struct call {
+        jint category;
+        jlong bytes;
+        jlong threshold;
+    };
+
+    // A Java listener whose calls land in seen, from the hook's thread.
+    struct listener {
+        jnipp::mock::jvm m;
+        std::mutex lock;
+        std::vector<call> seen;
+        bool throws = false;
+        jobject object;
+
+        listener(){
+            jclass c = m.define_class("com/example/Listener");
+            m.define_method(c, "onNativeMemoryPressure", "(IJJ)V", [this](jnipp::mock::jvm& v, jobject, jvalue const* a){
+                std::lock_guard<std::mutex> guard{ lock };
+                seen.push_back(call{ a[0].i, a[1].j, a[2].j });
+                if(throws) v.throw_new("java/lang/IllegalStateException", "listener");
+                return jvalue{};
+            });
+            object = m.env()->NewGlobalRef(m.new_object(c));
+        }
+        ~listener(){
+            m.env()->DeleteGlobalRef(object);
+        }
+        void set_throws(bool on){
+            std::lock_guard<std::mutex> guard{ lock };
+            throws = on;
+        }
+        std::size_t calls(){
+            std::lock_guard<std::mutex> guard{ lock };
+            return seen.size();
+        }
+        // Waits for the nth call, then a while for any that should not come.
+        bool exactly(std::size_t n){
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+            while(calls() < n && std::chrono::steady_clock::now() < deadline){
+                std::this_thread::sleep_for(milliseconds{ 1 });
+            }
+            std::this_thread::sleep_for(milliseconds{ 30 });
+            return calls() == n;
+        }
+        bool last_is(jint category, jlong bytes, jlong threshold){
+            std::lock_guard<std::mutex> guard{ lock };
+            return !seen.empty() && seen.back().category == category && seen.back().bytes == bytes &&
+                seen.back().threshold == threshold;
+        }
+    };
+
+    void thresholds(){
+        listener l;
+        memory::set_threshold(mine, 1000);
+        memory::set_total_threshold(5000);
+        auto hook = memory::pressure_hook::start(l.m.vm(), l.object);
+        JNIPP_CHECK(hook != nullptr);
+
+        memory::acquire(mine, 600);
+        JNIPP_CHECK(l.exactly(0));
+        memory::acquire(mine, 500);
+        JNIPP_CHECK(l.exactly(1) && l.last_is(mine, 1100, 1000));
+        // Still above the threshold: no second call.
+        memory::acquire(mine, 100);
+        JNIPP_CHECK(l.exactly(1));
+        auto u = memory::get(mine);
+        JNIPP_CHECK(u.bytes == 1200 && u.peak == 1200 && u.threshold == 1000);
+
+        // Dropping below re-arms the category.
+        memory::release(mine, 800);
+        JNIPP_CHECK(l.exactly(1) && memory::get(mine).peak == 1200);
+        memory::acquire(mine, 600);
+        JNIPP_CHECK(l.exactly(2) && l.last_is(mine, 1000, 1000));
+
+        // The total crosses through a category without a threshold.
+        memory::acquire(other, 4000);
+        JNIPP_CHECK(l.exactly(3) && l.last_is(-1, 5000, 5000));
+        JNIPP_CHECK(memory::total().bytes == 5000);
+
+        // A throwing listener is counted and cleared; the hook carries on.
+        memory::release(other, 4000);
+        memory::release(mine, 1000);
+        l.set_throws(true);
+        memory::acquire(mine, 1000);
+        JNIPP_CHECK(l.exactly(4) && hook->failed() == 1);
+        l.set_throws(false);
+        memory::release(mine, 1000);
+        memory::acquire(mine, 1000);
+        JNIPP_CHECK(l.exactly(5) && hook->failed() == 1);
+
+        // The mock is the hook thread's until the hook is gone.
+        hook.reset();
+        JNIPP_CHECK(l.m.env()->ExceptionCheck() == JNI_FALSE);
+        memory::release(mine, 1000);
+        memory::set_threshold(mine, 0);
+        memory::set_total_threshold(0);
+        JNIPP_CHECK(memory::total().bytes == 0);
+    }
+
+    void start_failures(){
+        listener l;
+        JNIPP_CHECK(memory::pressure_hook::start(l.m.vm(), l.object, "missing") == nullptr);
+        JNIPP_CHECK(l.m.env()->ExceptionCheck() == JNI_FALSE);
+        l.m.fail_attach(true);
+        JNIPP_CHECK(memory::pressure_hook::start(l.m.vm(), l.object) == nullptr);
+    }
+}
+
+int main(){
+    thresholds();
+    start_failures();
+    return jnipp_test::result();
+}
@@ -0,0 +1,143 @@
+//=============================================================================
+//! \file    jnipp/test/mmap.cpp
+//! \brief   mmap::files keeps a mapping alive until its windows are cleaned
+//=============================================================================
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_mmap.hpp"
+#include "test.hpp"
+
+namespace {
+    char const text[] = "hello, mapped world";
+
+    // A file holding text, removed with the fixture.
+    struct fixture {
+        char path[32];
+        jnipp::mock::jvm m;
+        jclass release_class;
+        jobject cleaner;
+        // (buffer, handle) of every registered Cleaner action.
+        std::vector<std::pair<jobject, jlong>> registered;
+        std::vector<jlong> constructed;
+
+        fixture(){
+            std::strcpy(path, "/tmp/jnipp_mmapXXXXXX");
+            int fd = ::mkstemp(path);
+            JNIPP_CHECK(fd >= 0 && ::write(fd, text, sizeof(text)) == static_cast<ssize_t>(sizeof(text)));
+            ::close(fd);
+
+            release_class = m.define_class("com/example/MappedFile$Release");
+            m.define_method(release_class, "<init>", "(J)V", [this](jnipp::mock::jvm&, jobject, jvalue const* a){
+                constructed.push_back(a[0].j);
+                jvalue r;
+                r.j = 0;
+                return r;
+            });
+            jclass cleaner_class = m.define_class("java/lang/ref/Cleaner");
+            jclass cleanable_class = m.define_class("java/lang/ref/Cleaner$Cleanable");
+            m.define_method(cleaner_class, "register",
+                "(Ljava/lang/Object;Ljava/lang/Runnable;)Ljava/lang/ref/Cleaner$Cleanable;",
+                [this, cleanable_class](jnipp::mock::jvm& v, jobject, jvalue const* a){
+                    registered.emplace_back(a[0].l, constructed.back());
+                    jvalue r;
+                    r.l = v.new_object(cleanable_class);
+                    return r;
+                });
+            jclass buffer_class = m.define_class("java/nio/DirectByteBuffer");
+            m.define_method(buffer_class, "asReadOnlyBuffer", "()Ljava/nio/ByteBuffer;",
+                [](jnipp::mock::jvm& v, jobject self, jvalue const*){
+                    jvalue r;
+                    r.l = v.env()->NewDirectByteBuffer(v.env()->GetDirectBufferAddress(self),
+                        v.env()->GetDirectBufferCapacity(self));
+                    return r;
+                });
+            cleaner = m.new_object(cleaner_class);
+        }
+        ~fixture(){
+            ::unlink(path);
+        }
+        std::int64_t mapped() const {
+            return jnipp::memory::get(jnipp::memory::mapped).bytes;
+        }
+    };
+
+    void lifetime(){
+        fixture f;
+        jnipp::mmap::files files{ f.m.env(), f.cleaner, f.release_class };
+        JNIPP_CHECK(static_cast<bool>(files));
+
+        auto h = files.open(std::unique_ptr<jnipp::mmap::mapping>{
+            new jnipp::mmap::mapping{ f.path, jnipp::mmap::mode::read_write } });
+        JNIPP_CHECK(h != 0 && files.get(h) != nullptr && files.get(h)->size() == sizeof(text));
+        JNIPP_CHECK(f.mapped() == static_cast<std::int64_t>(sizeof(text)));
+
+        auto w = files.window(f.m.env(), h, 7, 6);
+        JNIPP_CHECK(w && f.registered.size() == 1 && f.registered[0].first == *w);
+        auto bytes = static_cast<char const*>(f.m.env()->GetDirectBufferAddress(*w));
+        JNIPP_CHECK(f.m.env()->GetDirectBufferCapacity(*w) == 6 && std::memcmp(bytes, "mapped", 6) == 0);
+
+        // close() leaves the window readable.
+        files.release(h);
+        JNIPP_CHECK(files.get(h) == nullptr && f.mapped() == static_cast<std::int64_t>(sizeof(text)));
+        JNIPP_CHECK(std::memcmp(bytes, "mapped", 6) == 0);
+
+        // The Cleaner unmaps; running it twice is harmless.
+        files.release(f.registered[0].second);
+        JNIPP_CHECK(f.mapped() == 0);
+        files.release(f.registered[0].second);
+        f.m.env()->DeleteLocalRef(*w);
+    }
+
+    void read_only(){
+        fixture f;
+        jnipp::mmap::files files{ f.m.env(), f.cleaner, f.release_class };
+        auto h = files.open(std::unique_ptr<jnipp::mmap::mapping>{ new jnipp::mmap::mapping{ f.path } });
+        auto w = files.window(f.m.env(), h, 0, 5);
+        // The Cleaner watches the buffer the view keeps reachable, not the view.
+        JNIPP_CHECK(w && f.registered.size() == 1 && f.registered[0].first != *w);
+        JNIPP_CHECK(std::memcmp(f.m.env()->GetDirectBufferAddress(*w), "hello", 5) == 0);
+        f.m.env()->DeleteLocalRef(*w);
+        files.release(f.registered[0].second);
+        JNIPP_CHECK(f.mapped() == static_cast<std::int64_t>(sizeof(text)));
+        files.release(h);
+        JNIPP_CHECK(f.mapped() == 0);
+    }
+
+    void failures(){
+        fixture f;
+        jnipp::mmap::files files{ f.m.env(), f.cleaner, f.release_class };
+        JNIPP_CHECK(files.open(std::unique_ptr<jnipp::mmap::mapping>{ new jnipp::mmap::mapping{ "/nonexistent/jnipp" } }) == 0);
+
+        auto h = files.open(std::unique_ptr<jnipp::mmap::mapping>{ new jnipp::mmap::mapping{ f.path } });
+        auto out = files.window(f.m.env(), h, 4, sizeof(text));
+        JNIPP_CHECK(!out && std::string{ out.error().get_message() }.find("out of range") != std::string::npos);
+        JNIPP_CHECK(f.registered.empty() && f.constructed.empty());
+        files.release(h);
+        JNIPP_CHECK(f.mapped() == 0);
+
+        auto stale = files.window(f.m.env(), h, 0, 1);
+        JNIPP_CHECK(!stale && std::string{ stale.error().get_message() }.find("Stale handle") != std::string::npos);
+        JNIPP_CHECK(f.m.env()->ExceptionCheck() == JNI_FALSE);
+
+        // An action class without a (long) constructor.
+        jnipp::mmap::files broken{ f.m.env(), f.cleaner, f.m.define_class("com/example/Other") };
+        JNIPP_CHECK(!broken && f.m.env()->ExceptionCheck() == JNI_TRUE);
+        f.m.env()->ExceptionClear();
+    }
+}
+
+int main(){
+    lifetime();
+    read_only();
+    failures();
+    return jnipp_test::result();
+}
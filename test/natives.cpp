@@ -0,0 +1,122 @@
+//=============================================================================
+//! \file    jnipp/test/natives.cpp
+//! \brief   native_method signatures, trampolines and exception translation
+//=============================================================================
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    bool same(char const* a, char const* b){
+        return std::strcmp(a, b) == 0;
+    }
+
+    jint JNICALL raw_add(JNIEnv*, jobject, jint a, jlong b){
+        return a + static_cast<jint>(b);
+    }
+    void JNICALL raw_static(JNIEnv*, jclass, ::jstring, jobjectArray, jdoubleArray){
+    }
+    jobject JNICALL raw_object(JNIEnv*, jobject, jclass, jthrowable, jintArray){
+        return NULL;
+    }
+
+    std::int32_t add(jnipp::environment&, jobject, std::int32_t a, std::int64_t b){
+        return a + static_cast<std::int32_t>(b);
+    }
+    bool negate(jnipp::environment&, jclass, bool v){
+        return !v;
+    }
+    std::string greet(jnipp::environment&, jobject, std::string name, double times){
+        std::string r;
+        for(int i = 0; i < static_cast<int>(times); ++i) r += "hi " + name + ";";
+        return r;
+    }
+    std::int32_t length(jnipp::environment&, jobject, jnipp::utf_string s){
+        return static_cast<std::int32_t>(std::strlen(s.c_str()));
+    }
+    template<typename T>
+    T echo(jnipp::environment&, jobject, T v){
+        return v;
+    }
+    void reject(jnipp::environment&, jobject, float v){
+        if(v < 0) throw std::invalid_argument("negative");
+        throw std::out_of_range("too large");
+    }
+
+    void signatures(){
+        auto a = jnipp::native_method("add", &raw_add);
+        JNIPP_CHECK(same(a.name, "add") && same(a.signature, "(IJ)I") && a.fnPtr == reinterpret_cast<void*>(&raw_add));
+        JNIPP_CHECK(same(jnipp::native_method("s", &raw_static).signature,
+            "(Ljava/lang/String;[Ljava/lang/Object;[D)V"));
+        JNIPP_CHECK(same(jnipp::native_method("o", &raw_object).signature,
+            "(Ljava/lang/Class;Ljava/lang/Throwable;[I)Ljava/lang/Object;"));
+
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("add", add).signature, "(IJ)I"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("negate", negate).signature, "(Z)Z"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("greet", greet).signature, "(Ljava/lang/String;D)Ljava/lang/String;"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("reject", reject).signature, "(F)V"));
+
+        // Every primitive, by its JNI typedef and by its fixed-width type.
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jboolean>).signature, "(Z)Z"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jbyte>).signature, "(B)B"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jchar>).signature, "(C)C"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jshort>).signature, "(S)S"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jint>).signature, "(I)I"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jlong>).signature, "(J)J"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jfloat>).signature, "(F)F"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<jdouble>).signature, "(D)D"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<bool>).signature, "(Z)Z"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<std::int8_t>).signature, "(B)B"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<std::uint16_t>).signature, "(C)C"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<std::int16_t>).signature, "(S)S"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<std::int32_t>).signature, "(I)I"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<std::int64_t>).signature, "(J)J"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<float>).signature, "(F)F"));
+        JNIPP_CHECK(same(JNIPP_NATIVE_METHOD("echo", echo<double>).signature, "(D)D"));
+    }
+
+    void trampolines(){
+        jnipp::mock::jvm m;
+        JNIEnv* e = m.env();
+        jclass c = m.define_class("com/example/Natives");
+        jobject self = m.new_object(c);
+
+        static JNINativeMethod const methods[] = {
+            JNIPP_NATIVE_METHOD("add", add),
+            JNIPP_NATIVE_METHOD("negate", negate),
+            JNIPP_NATIVE_METHOD("greet", greet),
+            JNIPP_NATIVE_METHOD("reject", reject),
+        };
+        jnipp::clas k{ e, c };
+        JNIPP_CHECK(k.register_natives(methods));
+        JNIPP_CHECK(m.natives(c).size() == 4);
+
+        JNIPP_CHECK(jnipp::trampoline<decltype(&add), &add>::call(e, self, 40, 2) == 42);
+        JNIPP_CHECK(jnipp::trampoline<decltype(&negate), &negate>::call(e, c, JNI_FALSE) == JNI_TRUE);
+        JNIPP_CHECK(jnipp::trampoline<decltype(&echo<jbyte>), &echo<jbyte>>::call(e, self, jbyte{ -5 }) == -5);
+        JNIPP_CHECK(jnipp::trampoline<decltype(&echo<jchar>), &echo<jchar>>::call(e, self, jchar{ 0xffff }) == 0xffff);
+
+        ::jstring name = e->NewStringUTF("jni");
+        ::jstring r = jnipp::trampoline<decltype(&greet), &greet>::call(e, self, name, 2.0);
+        JNIPP_CHECK(std::string{ e->GetStringUTFChars(r, NULL) } == "hi jni;hi jni;");
+        JNIPP_CHECK(jnipp::trampoline<decltype(&length), &length>::call(e, self, name) == 3);
+
+        jnipp::trampoline<decltype(&reject), &reject>::call(e, self, -1.0f);
+        JNIPP_CHECK(m.class_name(m.exception()) == "java/lang/IllegalArgumentException");
+        JNIPP_CHECK(m.message(m.exception()) == "negative");
+        e->ExceptionClear();
+        jnipp::trampoline<decltype(&reject), &reject>::call(e, self, 1.0f);
+        JNIPP_CHECK(m.class_name(m.exception()) == "java/lang/IndexOutOfBoundsException");
+        e->ExceptionClear();
+    }
+}
+
+int main(){
+    signatures();
+    trampolines();
+    return jnipp_test::result();
+}
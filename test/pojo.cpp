@@ -0,0 +1,106 @@
+//=============================================================================
+//! \file    jnipp/test/pojo.cpp
+//! \brief   pojo::codec field lookup, decoding and encoding
+//=============================================================================
+#include <cstdint>
+#include <string>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_pojo.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace mock = jnipp::mock;
+
+    struct point {
+        std::int32_t x;
+        double y;
+        bool on;
+        std::int64_t id;
+        std::string label;
+    };
+    using point_codec = jnipp::pojo::codec<point,
+        JNIPP_POJO_FIELD(point, x, 'x'),
+        JNIPP_POJO_FIELD(point, y, 'y'),
+        JNIPP_POJO_FIELD(point, on, 'o','n'),
+        JNIPP_POJO_FIELD(point, id, 'i','d'),
+        JNIPP_POJO_FIELD(point, label, 'l','a','b','e','l')>;
+
+    // Narrow members keep their width: Java byte, short and char fields.
+    struct pixel {
+        std::int8_t dx;
+        std::uint8_t alpha;
+        std::int16_t depth;
+        std::uint16_t unit;
+    };
+    using pixel_codec = jnipp::pojo::codec<pixel,
+        JNIPP_POJO_FIELD(pixel, dx, 'd','x'),
+        JNIPP_POJO_FIELD(pixel, alpha, 'a','l','p','h','a'),
+        JNIPP_POJO_FIELD(pixel, depth, 'd','e','p','t','h'),
+        JNIPP_POJO_FIELD(pixel, unit, 'u','n','i','t')>;
+
+    struct unknown {
+        std::int32_t z;
+    };
+    using unknown_codec = jnipp::pojo::codec<unknown, JNIPP_POJO_FIELD(unknown, z, 'z')>;
+
+    void round_trip(){
+        mock::jvm m;
+        jclass c = m.define_class("com/example/Point");
+        m.define_field(c, "x", "I");
+        m.define_field(c, "y", "D");
+        m.define_field(c, "on", "Z");
+        m.define_field(c, "id", "J");
+        m.define_field(c, "label", "Ljava/lang/String;");
+
+        auto codec = point_codec::resolve(m.env(), c);
+        JNIPP_CHECK(codec);
+        JNIPP_CHECK(m.count(mock::function::GetFieldID) == 5);
+
+        jobject o = m.new_object(c);
+        JNIPP_CHECK(codec->encode(m.env(), point{ 3, 1.5, true, std::int64_t{ 1 } << 40, "hello" }, o));
+        m.reset_counters();
+        auto p = codec->decode(m.env(), o);
+        JNIPP_CHECK(p && p->x == 3 && p->y == 1.5 && p->on && p->id == std::int64_t{ 1 } << 40 && p->label == "hello");
+        // Decoding only reads fields: no lookups and no Java code.
+        JNIPP_CHECK(m.count(mock::function::GetFieldID) == 0 && m.count(mock::function::CallMethod) == 0);
+        JNIPP_CHECK(m.count(mock::function::GetField) == 5);
+    }
+
+    void narrow_fields(){
+        mock::jvm m;
+        jclass c = m.define_class("com/example/Pixel");
+        jfieldID dx = m.define_field(c, "dx", "B");
+        jfieldID alpha = m.define_field(c, "alpha", "B");
+        jfieldID depth = m.define_field(c, "depth", "S");
+        m.define_field(c, "unit", "C");
+
+        auto codec = pixel_codec::resolve(m.env(), c);
+        JNIPP_CHECK(codec);
+        jobject o = m.new_object(c);
+        JNIPP_CHECK(codec->encode(m.env(), pixel{ -5, 250, -30000, 65000 }, o));
+        // The unsigned byte reaches Java as the same bits.
+        JNIPP_CHECK(m.env()->GetByteField(o, dx) == -5 && m.env()->GetByteField(o, alpha) == -6);
+        JNIPP_CHECK(m.env()->GetShortField(o, depth) == -30000);
+
+        m.env()->SetByteField(o, alpha, -1);
+        auto p = codec->decode(m.env(), o);
+        JNIPP_CHECK(p && p->dx == -5 && p->alpha == 255 && p->depth == -30000 && p->unit == 65000);
+    }
+
+    void missing_field(){
+        mock::jvm m;
+        jclass c = m.define_class("com/example/Point");
+        auto codec = unknown_codec::resolve(m.env(), c);
+        JNIPP_CHECK(!codec && codec.error().has_exception());
+        JNIPP_CHECK(m.class_name(m.exception()) == "java/lang/NoSuchFieldError");
+        m.env()->ExceptionClear();
+    }
+}
+
+int main(){
+    round_trip();
+    narrow_fields();
+    missing_field();
+    return jnipp_test::result();
+}
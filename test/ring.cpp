@@ -0,0 +1,134 @@
+//=============================================================================
+//! \file    jnipp/test/ring.cpp
+//! \brief   ring::view records, wrap-around and a producer thread
+//=============================================================================
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_ring.hpp"
+#include "test.hpp"
+
+namespace {
+    void java_buffer(){
+        jnipp::mock::jvm m;
+        jnipp::ring::buffer b{ 1000 };
+        auto& r = b.get();
+        JNIPP_CHECK(r && r.capacity() == 1024);
+
+        auto java = jnipp::ring::to_java(m.env(), r);
+        JNIPP_CHECK(java && m.env()->GetDirectBufferCapacity(*java) == static_cast<jlong>(r.size_bytes()));
+        auto v = jnipp::ring::from_java(m.env(), *java);
+        JNIPP_CHECK(v && v->memory() == r.memory() && v->capacity() == r.capacity());
+
+        std::vector<unsigned char> garbage(r.size_bytes());
+        auto bad = jnipp::ring::open(garbage.data(), garbage.size());
+        JNIPP_CHECK(!bad);
+    }
+
+    void wrap_around(){
+        jnipp::ring::buffer b{ 1024 };
+        auto& r = b.get();
+        std::vector<unsigned char> payload(2048);
+        // Header plus payload must fit the ring.
+        JNIPP_CHECK(!r.write(payload.data(), 1020));
+        for(std::uint32_t round = 0; round < 100; ++round){
+            std::uint32_t n = 1 + round * 37 % 300;
+            for(std::uint32_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<unsigned char>(i + round);
+            std::size_t written = 0;
+            while(r.write(payload.data(), n)) ++written;
+            JNIPP_CHECK(written > 0);
+            std::size_t matched = 0;
+            auto got = r.read([&](void const* p, std::uint32_t len){
+                if(len == n && std::memcmp(p, payload.data(), n) == 0) ++matched;
+            });
+            JNIPP_CHECK(got && *got == written && matched == written);
+        }
+    }
+
+    // A record that only fits after the wrap, behind unread space.
+    void padding_alone(){
+        jnipp::ring::buffer b{ 64 };
+        auto& r = b.get();
+        unsigned char payload[56] = { 7 };
+        std::uint32_t length = 0;
+        auto keep = [&](void const*, std::uint32_t n){ length = n; };
+        JNIPP_CHECK(r.write(payload, 0) && *r.read(keep) == 1 && length == 0);
+        // Empty, but the 64-byte record does not fit before the end.
+        JNIPP_CHECK(!r.write(payload, 56));
+        JNIPP_CHECK(*r.read(keep) == 0);
+        JNIPP_CHECK(r.write(payload, 56) && *r.read(keep) == 1 && length == 56);
+        for(int i = 0; i < 10; ++i){
+            while(!r.write(payload, 20 + i)) r.read(keep);
+        }
+    }
+
+    // Java can write the header and records; read must not trust them.
+    void malformed(){
+        jnipp::ring::buffer b{ 64 };
+        auto& r = b.get();
+        auto data = static_cast<unsigned char*>(r.memory()) + sizeof(jnipp::ring::header);
+        auto h = static_cast<jnipp::ring::header*>(r.memory());
+        unsigned char payload[8] = { 1 };
+        std::size_t seen = 0;
+        auto count = [&](void const*, std::uint32_t){ ++seen; };
+        auto set_length = [&](std::int32_t n){ std::memcpy(data + 16, &n, sizeof(n)); };
+
+        JNIPP_CHECK(r.write(payload, 8) && r.write(payload, 8));
+        for(std::int32_t bad : { -1, -8, 48, 1 << 30, std::numeric_limits<std::int32_t>::max() }){
+            set_length(bad);
+            auto got = r.read(count);
+            // The first record is consumed, the second never passed.
+            JNIPP_CHECK(!got && h->tail.load() == 16);
+        }
+        JNIPP_CHECK(seen == 1);
+        set_length(8);
+        auto rest = r.read(count);
+        JNIPP_CHECK(rest && *rest == 1 && seen == 2 && h->tail.load() == h->head.load());
+
+        // A head further ahead than the ring holds.
+        h->head.store(h->tail.load() + r.capacity() + 8);
+        JNIPP_CHECK(!r.read(count) && seen == 2);
+        // A tail past head.
+        h->head.store(h->tail.load() - 8);
+        JNIPP_CHECK(!r.read(count) && seen == 2);
+    }
+
+    void threads(){
+        jnipp::ring::buffer b{ 4096 };
+        auto& r = b.get();
+        const std::uint64_t total = 100000;
+        std::thread producer{ [&]{
+            for(std::uint64_t i = 0; i < total; ++i){
+                std::uint32_t n = 8 + static_cast<std::uint32_t>(i % 5) * 4;
+                while(!r.write(n, [&](void* p){ std::memcpy(p, &i, sizeof(i)); })){
+                    std::this_thread::yield();
+                }
+            }
+        } };
+        std::uint64_t expected = 0;
+        std::uint64_t mismatches = 0;
+        while(expected < total){
+            r.read([&](void const* p, std::uint32_t n){
+                std::uint64_t i;
+                std::memcpy(&i, p, sizeof(i));
+                if(i != expected || n != 8 + i % 5 * 4) ++mismatches;
+                ++expected;
+            });
+        }
+        producer.join();
+        JNIPP_CHECK(mismatches == 0);
+    }
+}
+
+int main(){
+    java_buffer();
+    wrap_around();
+    padding_alone();
+    malformed();
+    threads();
+    return jnipp_test::result();
+}
@@ -0,0 +1,130 @@
+//=============================================================================
+//! \file    jnipp/test/soa.cpp
+//! \brief   soa::layout arrays, member widths and invoke on the mock
+//=============================================================================
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_soa.hpp"
+#include "test.hpp"
+
+namespace {
+    struct sample {
+        std::int8_t level;
+        std::uint8_t flags;
+        bool live;
+        std::uint16_t unit;
+        std::int16_t delta;
+        std::int64_t time;
+        double price;
+    };
+    using samples = jnipp::soa::layout<sample,
+        JNIPP_SOA_FIELD(sample, level), JNIPP_SOA_FIELD(sample, flags), JNIPP_SOA_FIELD(sample, live),
+        JNIPP_SOA_FIELD(sample, unit), JNIPP_SOA_FIELD(sample, delta), JNIPP_SOA_FIELD(sample, time),
+        JNIPP_SOA_FIELD(sample, price)>;
+
+    // Byte-sized members fill byte arrays, not the char arrays the method
+    // resolver would pick for std::uint8_t.
+    static_assert(std::is_same<JNIPP_SOA_FIELD(sample, level)::array, jbyteArray>::value, "");
+    static_assert(std::is_same<JNIPP_SOA_FIELD(sample, flags)::array, jbyteArray>::value, "");
+    static_assert(std::is_same<JNIPP_SOA_FIELD(sample, live)::array, jbooleanArray>::value, "");
+    static_assert(std::is_same<JNIPP_SOA_FIELD(sample, unit)::array, jcharArray>::value, "");
+
+    std::vector<sample> const records = {
+        { -128, 255, true, 65535, -2, 1000, 1.5 },
+        { 127, 1, false, 7, 300, -1, -2.25 },
+        { 0, 128, true, 0, 0, INT64_MAX, 0.0 },
+    };
+
+    // Reads every array of one to_java() call back into records.
+    std::vector<sample> read(JNIEnv* env, samples::arrays const& a){
+        std::vector<sample> out(static_cast<std::size_t>(env->GetArrayLength(std::get<0>(a))));
+        for(std::size_t i = 0; i < out.size(); ++i){
+            auto at = static_cast<jsize>(i);
+            jbyte b;
+            jboolean z;
+            jchar c;
+            jshort s;
+            jlong j;
+            jdouble d;
+            env->GetByteArrayRegion(std::get<0>(a), at, 1, &b);
+            out[i].level = b;
+            env->GetByteArrayRegion(std::get<1>(a), at, 1, &b);
+            out[i].flags = static_cast<std::uint8_t>(b);
+            env->GetBooleanArrayRegion(std::get<2>(a), at, 1, &z);
+            out[i].live = z == JNI_TRUE;
+            env->GetCharArrayRegion(std::get<3>(a), at, 1, &c);
+            out[i].unit = c;
+            env->GetShortArrayRegion(std::get<4>(a), at, 1, &s);
+            out[i].delta = s;
+            env->GetLongArrayRegion(std::get<5>(a), at, 1, &j);
+            out[i].time = j;
+            env->GetDoubleArrayRegion(std::get<6>(a), at, 1, &d);
+            out[i].price = d;
+        }
+        return out;
+    }
+    bool same(std::vector<sample> const& a, std::vector<sample> const& b){
+        if(a.size() != b.size()) return false;
+        for(std::size_t i = 0; i < a.size(); ++i){
+            if(a[i].level != b[i].level || a[i].flags != b[i].flags || a[i].live != b[i].live ||
+               a[i].unit != b[i].unit || a[i].delta != b[i].delta || a[i].time != b[i].time ||
+               a[i].price != b[i].price) return false;
+        }
+        return true;
+    }
+
+    void round_trip(){
+        jnipp::mock::jvm m;
+        auto a = samples::to_java(m.env(), records);
+        JNIPP_CHECK(a && m.local_refs() == 7);
+        JNIPP_CHECK(same(read(m.env(), *a), records));
+        samples::release(m.env(), *a);
+        JNIPP_CHECK(m.local_refs() == 0);
+
+        auto empty = samples::to_java(m.env(), std::vector<sample>{});
+        JNIPP_CHECK(empty && m.env()->GetArrayLength(std::get<0>(*empty)) == 0);
+        samples::release(m.env(), *empty);
+
+        m.fail_allocations(true);
+        auto failed = samples::to_java(m.env(), records);
+        JNIPP_CHECK(!failed && failed.error().has_exception() && m.local_refs() == 0);
+        m.env()->ExceptionClear();
+    }
+
+    void invoke(){
+        jnipp::mock::jvm m;
+        jclass sink = m.define_class("com/example/Sink");
+        std::vector<sample> seen;
+        jint tag = 0;
+        m.define_method(sink, "onSamples", "(I[B[B[Z[C[S[J[D)I",
+            [&](jnipp::mock::jvm& v, jobject, jvalue const* args){
+                tag = args[0].i;
+                samples::arrays a{ static_cast<jbyteArray>(args[1].l), static_cast<jbyteArray>(args[2].l),
+                    static_cast<jbooleanArray>(args[3].l), static_cast<jcharArray>(args[4].l),
+                    static_cast<jshortArray>(args[5].l), static_cast<jlongArray>(args[6].l),
+                    static_cast<jdoubleArray>(args[7].l) };
+                seen = read(v.env(), a);
+                jvalue r;
+                r.i = static_cast<jint>(seen.size());
+                return r;
+            });
+        jobject o = m.new_object(sink);
+        jnipp::environment env{ m.env() };
+        auto c = *env.find_class("com/example/Sink");
+        auto on_samples = c.get_method<samples::signature<std::int32_t, std::int32_t>>("onSamples");
+        JNIPP_CHECK(static_cast<bool>(on_samples));
+        auto n = samples::invoke(m.env(), *on_samples, o, records, jint{ 42 });
+        JNIPP_CHECK(n && *n == 3 && tag == 42 && same(seen, records));
+        JNIPP_CHECK(m.local_refs() == 1);  // the class from find_class
+    }
+}
+
+int main(){
+    round_trip();
+    invoke();
+    return jnipp_test::result();
+}
@@ -0,0 +1,66 @@
+//=============================================================================
+//! \file    jnipp/test/stats.cpp
+//! \brief   stats keys and names of calls and lookups
+//=============================================================================
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jnipp_mock.hpp"
+#include "jnipp_pojo.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace stats = jnipp::stats;
+
+    struct holder {
+        std::int64_t x;
+    };
+    using holder_codec = jnipp::pojo::codec<holder, JNIPP_POJO_FIELD(holder, x, 'x')>;
+
+    stats::entry const* find(std::vector<stats::entry> const& s, stats::op o, std::string const& name){
+        for(auto& e : s){
+            if(e.operation == o && name == e.name) return &e;
+        }
+        return nullptr;
+    }
+
+    void keys(){
+        jnipp::mock::jvm m;
+        auto a = m.define_class("com/example/A");
+        auto b = m.define_class("com/example/B");
+        m.define_method(a, "f", "(I)I", [](jnipp::mock::jvm&, jobject, jvalue const* v){
+            return v[0];
+        });
+        m.define_field(b, "x", "J");
+        jnipp::environment env{ m.env() };
+
+        for(int i = 0; i < 2; ++i){
+            auto ca = env.find_class("com/example/A");
+            auto cb = env.find_class(std::string{ "com/example/B" });
+            JNIPP_CHECK(ca && cb);
+            auto f = ca->get_method<std::int32_t(std::int32_t)>("f");
+            JNIPP_CHECK(cb->get_field<std::int64_t>("x"));
+            JNIPP_CHECK(f && (*f)(m.new_object(a), 3) == 3);
+        }
+        // pojo lookups go through the same instrumented path.
+        JNIPP_CHECK(holder_codec::resolve(*env.find_class("com/example/B")));
+
+        auto s = stats::snapshot();
+        // One key per class, however many local references the lookups made.
+        auto fa = find(s, stats::op::find_class, "com/example/A");
+        auto fb = find(s, stats::op::find_class, "com/example/B");
+        JNIPP_CHECK(fa && fa->count == 2 && fb && fb->count == 3);
+        auto gm = find(s, stats::op::get_method, "com/example/A");
+        auto gf = find(s, stats::op::get_field, "com/example/B");
+        JNIPP_CHECK(gm && gm->count == 2 && gf && gf->count == 3);
+        auto call = find(s, stats::op::call, "com/example/A.f(I)I");
+        JNIPP_CHECK(call && call->count == 2 && call->percentile(0.5) >= call->percentile(0.0));
+        JNIPP_CHECK(stats::dropped() == 0);
+    }
+}
+
+int main(){
+    keys();
+    return jnipp_test::result();
+}
@@ -0,0 +1,30 @@
+//=============================================================================
+//! \file    jnipp/test/test.hpp
+//! \brief   Checks shared by the tests
+//!
+//! JNIPP_CHECK reports a failed condition and carries on, so one run lists
+//! every failure; the test's main() returns jnipp_test::result().
+//=============================================================================
+#ifndef JNIPP_TEST_TEST_HPP
+#define JNIPP_TEST_TEST_HPP
+
+#include <cstdio>
+
+namespace jnipp_test {
+    inline int& failures() noexcept {
+        static int n = 0;
+        return n;
+    }
+    inline void check(bool ok, char const* condition, char const* file, int line) noexcept {
+        if(ok) return;
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        ++failures();
+    }
+    inline int result() noexcept {
+        return failures() == 0 ? 0 : 1;
+    }
+}
+
+#define JNIPP_CHECK(...) ::jnipp_test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+#endif // JNIPP_TEST_TEST_HPP
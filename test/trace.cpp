@@ -0,0 +1,148 @@
+//=============================================================================
+//! \file    jnipp/test/trace.cpp
+//! \brief   trace events of calls and field accesses as Chrome trace JSON
+//=============================================================================
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    // One "X" event of the file, as flush_chrome_json writes it: one event
+    // a line.
+    struct event {
+        std::string name;
+        std::string signature;
+        double ts;
+        double dur;
+        unsigned tid;
+    };
+
+    std::string text(std::string const& line, char const* key){
+        auto at = line.find(std::string{ "\"" } + key + "\":\"");
+        if(at == std::string::npos) return {};
+        std::string s;
+        for(auto i = line.find(':', at) + 2; i < line.size() && line[i] != '"'; ++i){
+            if(line[i] == '\\') ++i;
+            s += line[i];
+        }
+        return s;
+    }
+    double number(std::string const& line, char const* key){
+        auto at = line.find(std::string{ "\"" } + key + "\":");
+        return at == std::string::npos ? -1.0 : std::strtod(line.c_str() + line.find(':', at) + 1, nullptr);
+    }
+
+    // Flushes into a temporary file and parses it; well-formed checks
+    // every event line and the surrounding object.
+    std::vector<event> flush(bool& well_formed){
+        char path[] = "/tmp/jnipp_traceXXXXXX";
+        ::close(::mkstemp(path));
+        JNIPP_CHECK(jnipp::trace::flush_chrome_json(path));
+        std::ifstream in{ path };
+        std::stringstream all;
+        all << in.rdbuf();
+        ::unlink(path);
+
+        std::vector<event> events;
+        std::string line;
+        std::getline(all, line);
+        well_formed = line == "{\"traceEvents\":[";
+        while(std::getline(all, line) && line != "]}"){
+            if(line.back() == ',') line.pop_back();
+            well_formed = well_formed && line.front() == '{' && line.back() == '}' &&
+                line.find("\"cat\":\"jni\",\"ph\":\"X\"") != std::string::npos &&
+                line.find("\"pid\":1") != std::string::npos;
+            events.push_back(event{ text(line, "name"), text(line, "signature"),
+                number(line, "ts"), number(line, "dur"), static_cast<unsigned>(number(line, "tid")) });
+        }
+        well_formed = well_formed && line == "]}" && !std::getline(all, line);
+        return events;
+    }
+
+    void calls(){
+        jnipp::mock::jvm m;
+        jclass a = m.define_class("com/example/A");
+        m.define_method(a, "f", "(I)I", [](jnipp::mock::jvm&, jobject, jvalue const* v){
+            return v[0];
+        });
+        m.define_field(a, "x", "J");
+        jobject o = m.new_object(a);
+        jnipp::environment env{ m.env() };
+        auto c = *env.find_class("com/example/A");
+        auto f = *c.get_method<std::int32_t(std::int32_t)>("f");
+        auto x = *c.get_field<std::int64_t>("x");
+
+        bool well_formed = false;
+        // Lookups alone record nothing.
+        JNIPP_CHECK(flush(well_formed).empty() && well_formed);
+
+        auto before = jnipp::trace::now_ns();
+        JNIPP_CHECK(f(o, 1) == 1 && f(o, 2) == 2);
+        x.set(o, 3);
+        std::thread other{ [&]{
+            jnipp::environment e{ m.env() };
+            auto g = *e.find_class("com/example/A")->get_method<std::int32_t(std::int32_t)>("f");
+            g(o, 4);
+        } };
+        other.join();
+        auto after = jnipp::trace::now_ns();
+
+        auto events = flush(well_formed);
+        JNIPP_CHECK(well_formed && events.size() == 4);
+        unsigned main_tid = events.empty() ? 0 : events[0].tid;
+        unsigned other_tid = 0;
+        int main_events = 0;
+        double last = 0.0;
+        for(auto& e : events){
+            JNIPP_CHECK(e.ts * 1000.0 >= static_cast<double>(before) - 1.0 && e.dur >= 0.0);
+            JNIPP_CHECK((e.ts + e.dur) * 1000.0 <= static_cast<double>(after) + 1.0);
+            if(e.tid == main_tid){
+                // A thread's events come out in the order it recorded them.
+                JNIPP_CHECK(e.ts >= last);
+                last = e.ts;
+                ++main_events;
+            }
+            else{
+                other_tid = e.tid;
+                JNIPP_CHECK(e.name == "com/example/A.f" && e.signature == "(I)I");
+            }
+        }
+        JNIPP_CHECK(main_events == 3 && other_tid != 0 && other_tid != main_tid);
+        if(events.size() == 4){
+            JNIPP_CHECK(events[0].name == "com/example/A.f" && events[0].signature == "(I)I");
+            JNIPP_CHECK(events[2].name == "com/example/A.x" && events[2].signature == "J");
+        }
+
+        // Flushing drains the rings.
+        JNIPP_CHECK(flush(well_formed).empty() && well_formed);
+        JNIPP_CHECK(jnipp::trace::dropped() == 0);
+    }
+
+    void native_spans(){
+        auto site = jnipp::trace::intern("native", "say \"hi\"\\now", "\t");
+        JNIPP_CHECK(jnipp::trace::intern("native", "say \"hi\"\\now", "\t") == site);
+        jnipp::trace::record(site, 5000, 7500);
+        bool well_formed = false;
+        auto events = flush(well_formed);
+        JNIPP_CHECK(well_formed && events.size() == 1);
+        if(events.size() == 1){
+            JNIPP_CHECK(events[0].name == "native.say \"hi\"\\now" && events[0].ts == 5.0 && events[0].dur == 2.5);
+        }
+    }
+}
+
+int main(){
+    calls();
+    native_spans();
+    return jnipp_test::result();
+}
@@ -0,0 +1,64 @@
+//=============================================================================
+//! \file    jnipp/test/warmup.cpp
+//! \brief   warmup profiles, the warm cache and per-thread memos
+//=============================================================================
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "jnipp_mock.hpp"
+#include "test.hpp"
+
+namespace {
+    namespace mock = jnipp::mock;
+
+    void lookup(JNIEnv* e){
+        jnipp::environment env{ e };
+        auto c = env.find_class(std::string{ "com/example/Warm" });
+        JNIPP_CHECK(c && c->get_method<std::int32_t()>(std::string{ "get" }) && c->get_field<double>("x"));
+        e->DeleteLocalRef(c->get());
+    }
+
+    void profile(){
+        mock::jvm m;
+        auto c = m.define_class("com/example/Warm");
+        m.define_method(c, "get", "()I");
+        m.define_field(c, "x", "D");
+        std::string path = "warmup_test.profile";
+
+        // Recorded once however often, and from however many threads.
+        lookup(m.env());
+        lookup(m.env());
+        std::thread t{ [&]{ lookup(m.env()); } };
+        t.join();
+        JNIPP_CHECK(jnipp::warmup::save(path.c_str()));
+        std::string text;
+        if(auto f = std::fopen(path.c_str(), "r")){
+            char buffer[256];
+            while(std::fgets(buffer, sizeof(buffer), f) != nullptr) text += buffer;
+            std::fclose(f);
+        }
+        JNIPP_CHECK(text == "jnipp-warmup 1\nC\tcom/example/Warm\nM\tcom/example/Warm\tget\t()I\nF\tcom/example/Warm\tx\tD\n");
+
+        auto r = jnipp::warmup::load(m.env(), path.c_str());
+        JNIPP_CHECK(r.resolved == 3 && r.failed == 0);
+        m.reset_counters();
+        lookup(m.env());
+        lookup(m.env());
+        JNIPP_CHECK(m.count(mock::function::FindClass) == 0 && m.count(mock::function::GetMethodID) == 0 &&
+            m.count(mock::function::GetFieldID) == 0);
+
+        // After unload the memos of this thread no longer serve the cache.
+        jnipp::warmup::unload(m.env());
+        m.reset_counters();
+        lookup(m.env());
+        JNIPP_CHECK(m.count(mock::function::FindClass) == 1 && m.count(mock::function::GetMethodID) == 1);
+        std::remove(path.c_str());
+    }
+}
+
+int main(){
+    profile();
+    return jnipp_test::result();
+}